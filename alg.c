@@ -0,0 +1,270 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include "alg.h"
+#include "helpers.h"
+
+#define NUM_AXES 3
+
+/* Every axis measures its layers from one face. Conveniently, the B, L and U
+ * faces have the same indices as the axes they turn around, so a move is on
+ * the measuring face of its axis exactly when face == axis.
+ */
+static const int AXIS_OF_FACE[] = {0, 1, 2, 1, 2, 0};
+static const int OPPOSITE_FACE[] = {5, 3, 4, 1, 2, 0};
+
+/******************************
+ * HELPER FUNCTION PROTOTYPES *
+ ******************************/
+
+/* Describes m by the layer it turns, counted from the measuring face of its
+ * axis, and by the clockwise quarter turns as seen from that face. Face turns
+ * and the deepest slice behind them share a layer but not a key, since only
+ * the face turn rotates the face's own stickers. Keys sort by layer.
+ */
+void get_slot(move_t m, int side_len, int *key, int *turns);
+
+/* The reverse of get_slot.
+ */
+move_t slot_to_move(int axis, int key, int turns, int side_len);
+
+/****************************
+ * FUNCTION IMPLEMENTATIONS *
+ ****************************/
+
+alg_t *new_alg(int side_len){
+  alg_t *ret = Calloc(1, sizeof(alg_t));
+  ret->side_len = side_len;
+  ret->capacity = 16;
+  ret->moves = Calloc(ret->capacity, sizeof(move_t));
+
+  return ret;
+}
+
+void free_alg(alg_t *a){
+  if(a == NULL){
+    return;
+  }
+
+  free(a->moves);
+  free(a);
+}
+
+alg_t *copy_alg(alg_t *a){
+  alg_t *copy = new_alg(a->side_len);
+  for(int i = 0; i < a->len; i++){
+    alg_append(copy, a->moves[i]);
+  }
+
+  return copy;
+}
+
+void alg_append(alg_t *a, move_t m){
+  if(a == NULL){
+    return;
+  }
+
+  //Grow by doubling so appending stays cheap for long logs
+  if(a->len == a->capacity){
+    move_t *bigger = Calloc(a->capacity * 2, sizeof(move_t));
+    memcpy(bigger, a->moves, a->len * sizeof(move_t));
+    free(a->moves);
+    a->moves = bigger;
+    a->capacity *= 2;
+  }
+
+  a->moves[a->len] = m;
+  a->len++;
+}
+
+alg_t *parse_alg(int side_len, const char *str){
+  if(str == NULL){
+    return NULL;
+  }
+
+  alg_t *ret = new_alg(side_len);
+  char *token = Calloc(strlen(str) + 1, sizeof(char));
+  int i = 0;
+
+  while(str[i] != '\0'){
+    //Skip separators
+    if(isspace(str[i]) || str[i] == ','){
+      i++;
+      continue;
+    }
+
+    //Copy out the next token
+    int token_len = 0;
+    while(str[i] != '\0' && !isspace(str[i]) && str[i] != ','){
+      token[token_len] = str[i];
+      token_len++;
+      i++;
+    }
+    token[token_len] = '\0';
+
+    move_t m;
+    if(!parse_move(token, &m) || m.depth >= side_len){
+      free(token);
+      free_alg(ret);
+      return NULL;
+    }
+    alg_append(ret, m);
+  }
+
+  free(token);
+
+  return ret;
+}
+
+char *alg_to_string(alg_t *a){
+  if(a == NULL){
+    return NULL;
+  }
+
+  char *ret = Calloc(a->len * MAX_MOVE_STR_LEN + 1, sizeof(char));
+  char buf[MAX_MOVE_STR_LEN];
+  int pos = 0;
+
+  for(int i = 0; i < a->len; i++){
+    move_to_string(a->moves[i], buf);
+    if(i > 0){
+      ret[pos] = ' ';
+      pos++;
+    }
+    int buf_len = strlen(buf);
+    memcpy(ret + pos, buf, buf_len);
+    pos += buf_len;
+  }
+
+  return ret;
+}
+
+alg_t *invert_alg(alg_t *a){
+  if(a == NULL){
+    return NULL;
+  }
+
+  alg_t *ret = new_alg(a->side_len);
+  for(int i = a->len - 1; i >= 0; i--){
+    move_t m = a->moves[i];
+    m.turns = 4 - m.turns;
+    alg_append(ret, m);
+  }
+
+  return ret;
+}
+
+int move_axis(move_t m){
+  return AXIS_OF_FACE[m.face];
+}
+
+void simplify_alg(alg_t *a){
+  if(a == NULL){
+    return;
+  }
+
+  /* The output is built in place at the front of the array, which can never
+   * outgrow the part that has been read. It is kept canonical, so the only
+   * place a new move can combine with anything is the run of moves on its
+   * axis at the very end. That run holds at most one move per key, which
+   * bounds the work per move by the cube size rather than the alg length.
+   */
+  int n = a->side_len;
+  int out_len = 0;
+
+  for(int i = 0; i < a->len; i++){
+    move_t m = a->moves[i];
+
+    //Moves make_move would ignore can simply be dropped
+    if(m.face < 0 || m.face >= 6 || m.depth < 0 || m.depth >= n){
+      continue;
+    }
+    m.turns = ((m.turns % 4) + 4) % 4;
+    if(m.turns == 0){
+      continue;
+    }
+
+    int axis = move_axis(m);
+    int key, turns;
+    get_slot(m, n, &key, &turns);
+
+    //Find the start of the trailing run on this axis
+    int start = out_len;
+    while(start > 0 && move_axis(a->moves[start - 1]) == axis){
+      start--;
+    }
+
+    //Look for the same slot, or the place the new one sorts into
+    int j = start;
+    int j_key = 0, j_turns = 0;
+    while(j < out_len){
+      get_slot(a->moves[j], n, &j_key, &j_turns);
+      if(j_key >= key){
+        break;
+      }
+      j++;
+    }
+
+    if(j < out_len && j_key == key){
+      //Merge with the existing turn, removing it if they cancel out
+      turns = (turns + j_turns) % 4;
+      if(turns == 0){
+        memmove(a->moves + j, a->moves + j + 1,
+                (out_len - j - 1) * sizeof(move_t));
+        out_len--;
+      }
+      else{
+        a->moves[j] = slot_to_move(axis, key, turns, n);
+      }
+    }
+    else{
+      memmove(a->moves + j + 1, a->moves + j, (out_len - j) * sizeof(move_t));
+      a->moves[j] = slot_to_move(axis, key, turns, n);
+      out_len++;
+    }
+  }
+
+  a->len = out_len;
+}
+
+/********************
+ * HELPER FUNCTIONS *
+ ********************/
+
+void get_slot(move_t m, int side_len, int *key, int *turns){
+  bool from_axis_face = m.face == AXIS_OF_FACE[m.face];
+  int layer = from_axis_face ? m.depth : side_len - 1 - m.depth;
+
+  *key = layer * 2 + (m.depth == 0 ? 0 : 1);
+  *turns = from_axis_face ? m.turns : 4 - m.turns;
+}
+
+move_t slot_to_move(int axis, int key, int turns, int side_len){
+  int layer = key / 2;
+  bool face_turn = key % 2 == 0;
+  bool from_axis_face;
+
+  if(face_turn){
+    from_axis_face = layer == 0;
+  }
+  else{
+    //Interior slices are written from whichever face is closer
+    from_axis_face = layer == side_len - 1
+      || (layer != 0 && layer <= side_len - 1 - layer);
+  }
+
+  move_t ret;
+  if(from_axis_face){
+    ret.face = axis;
+    ret.depth = layer;
+    ret.turns = turns;
+  }
+  else{
+    ret.face = OPPOSITE_FACE[axis];
+    ret.depth = side_len - 1 - layer;
+    ret.turns = 4 - turns;
+  }
+
+  return ret;
+}
@@ -0,0 +1,59 @@
+#ifndef ALG_H
+#define ALG_H
+
+#include <stdbool.h>
+#include "state.h"
+
+/* An algorithm is a sequence of parsed moves for a cube of a given size.
+ */
+typedef struct alg_t{
+  int side_len;
+  int len;
+  int capacity;
+  move_t *moves;
+} alg_t;
+
+/* Returns an empty algorithm for cubes of the given size.
+ */
+alg_t *new_alg(int side_len);
+
+/* Frees a given algorithm.
+ */
+void free_alg(alg_t *a);
+
+/* Returns an exact duplicate of a given algorithm.
+ */
+alg_t *copy_alg(alg_t *a);
+
+/* Adds m to the end of a.
+ */
+void alg_append(alg_t *a, move_t m);
+
+/* Parses a whitespace or comma separated list of moves, each written the way
+ * make_move expects them. Returns NULL if any of the moves is invalid or too
+ * deep for a cube of side_len. str must be a valid, NULL-Terminated string.
+ */
+alg_t *parse_alg(int side_len, const char *str);
+
+/* Returns a newly allocated string with every move of a separated by spaces.
+ * The caller is responsible for freeing it.
+ */
+char *alg_to_string(alg_t *a);
+
+/* Returns the algorithm that undoes a.
+ */
+alg_t *invert_alg(alg_t *a);
+
+/* Returns the axis m turns around: 0 for B-F, 1 for L-R and 2 for U-D.
+ */
+int move_axis(move_t m);
+
+/* Rewrites a in place into an equivalent, never longer algorithm. Inverse
+ * pairs cancel ("R R'"), turns of the same slice merge modulo 4 ("U U U"
+ * becomes "U'"), and every run of moves on one axis, which all commute, is
+ * sorted into a canonical order so that cancellation works across them
+ * ("R L R" becomes "L R2"). Runs in time linear in the length of a.
+ */
+void simplify_alg(alg_t *a);
+
+#endif
@@ -0,0 +1,1037 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "alg.h"
+#include "batch.h"
+#include "check.h"
+#include "comm.h"
+#include "helpers.h"
+#include "recog.h"
+#include "reduce.h"
+#include "replay.h"
+#include "serve.h"
+#include "shuffle.h"
+#include "twophase.h"
+#include "verify.h"
+
+#define MAX_LINE_LEN 4096
+#define DEFAULT_BENCH_MOVES 1000000
+#define MAX_BENCH_SIZE 9
+#define DEFAULT_CHECK_RUNS 20
+#define DEFAULT_CHECK_MOVES 500
+#define DEFAULT_COMM_SIZE 4
+#define DEFAULT_COMM_PIECES 3
+#define DEFAULT_COMM_A 3
+#define DEFAULT_COMM_B 1
+#define DEFAULT_COMM_C 1
+#define RECOGNIZE_REPEATS 1000
+
+/******************************
+ * HELPER FUNCTION PROTOTYPES *
+ ******************************/
+
+/* Prints the list of commands to stderr and returns the status to exit with.
+ */
+int usage(const char *prog);
+
+/* Reads the "-n <size>" option if argv[*i] is one, leaving *i on the size.
+ * Returns false if argv[*i] is not the option.
+ */
+bool read_size_option(int argc, char **argv, int *i, int *side_len);
+
+/* Simplifies and prints a single algorithm. Returns false if it was invalid.
+ */
+bool simplify_line(int side_len, const char *line);
+
+/* The "simplify" command.
+ */
+int simplify_main(int argc, char **argv);
+
+/* The "replay" command.
+ */
+int replay_main(int argc, char **argv);
+
+/* The "verify" command.
+ */
+int verify_main(int argc, char **argv);
+
+/* Solves and prints the solution to a single state, reporting how long it
+ * took on stderr. A 3x3 is solved directly and anything else by reduction,
+ * with each phase reported. Returns false if it could not be solved.
+ */
+bool solve_one(state_t *s, const solve_options_t *opts);
+
+/* The "solve" command.
+ */
+int solve_main(int argc, char **argv);
+
+/* Applies count moves to s and returns how many seconds it took.
+ */
+double time_moves(state_t *s, const move_t *moves, long count);
+
+/* Times the generic and specialized move code on the given size and prints a
+ * line comparing them, followed by a line for each shuffle engine if the size
+ * has them and one for a packed state if the size can be packed. Returns
+ * false if any of them did not end in the same state.
+ */
+bool bench_size(int side_len, long count);
+
+/* Times count moves with the given shuffle engine, starting from a solved
+ * cube, and prints a line comparing it to generic_time. Returns false if it
+ * did not end in the state expected.
+ */
+bool bench_shuffle(int engine,
+                   const move_t *moves,
+                   long count,
+                   double generic_time,
+                   state_t *expected);
+
+/* The "bench" command.
+ */
+int bench_main(int argc, char **argv);
+
+/* Prints what run_checks found: a line for each engine on each size with its
+ * speed relative to the reference, and the shortest failing sequence of any
+ * engine that disagreed.
+ */
+void print_check_results(check_results_t *r);
+
+/* The "check" command.
+ */
+int check_main(int argc, char **argv);
+
+/* Returns the moves comm uses when none are given: U, R and F turned at every
+ * depth up to the middle of the cube.
+ */
+alg_t *default_generators(int side_len);
+
+/* The "comm" command.
+ */
+int comm_main(int argc, char **argv);
+
+/* The "serve" command.
+ */
+int serve_main(int argc, char **argv);
+
+/* Sends a single request to the server on fd and prints its response.
+ * Returns false if the connection failed or the response was an error.
+ */
+bool call_one(int fd, const char *request);
+
+/* The "call" command.
+ */
+int call_main(int argc, char **argv);
+
+/* Looks up the last layer case of the state on a line and prints it with
+ * its first algorithm. If seconds is not NULL, the lookup is also repeated
+ * RECOGNIZE_REPEATS times to time it, adding the time one took to *seconds.
+ * Returns false if the line is invalid or the case is not in the table.
+ */
+bool recognize_one(case_table_t *t, const char *line, double *seconds);
+
+/* The "recognize" command.
+ */
+int recognize_main(int argc, char **argv);
+
+/****************************
+ * FUNCTION IMPLEMENTATIONS *
+ ****************************/
+
+int batch_main(int argc, char **argv){
+  if(argc < 2){
+    return usage(argv[0]);
+  }
+
+  if(strcmp(argv[1], "simplify") == 0){
+    return simplify_main(argc, argv);
+  }
+  if(strcmp(argv[1], "replay") == 0){
+    return replay_main(argc, argv);
+  }
+  if(strcmp(argv[1], "verify") == 0){
+    return verify_main(argc, argv);
+  }
+  if(strcmp(argv[1], "solve") == 0){
+    return solve_main(argc, argv);
+  }
+  if(strcmp(argv[1], "bench") == 0){
+    return bench_main(argc, argv);
+  }
+  if(strcmp(argv[1], "check") == 0){
+    return check_main(argc, argv);
+  }
+  if(strcmp(argv[1], "comm") == 0){
+    return comm_main(argc, argv);
+  }
+  if(strcmp(argv[1], "serve") == 0){
+    return serve_main(argc, argv);
+  }
+  if(strcmp(argv[1], "call") == 0){
+    return call_main(argc, argv);
+  }
+  if(strcmp(argv[1], "recognize") == 0){
+    return recognize_main(argc, argv);
+  }
+
+  return usage(argv[0]);
+}
+
+/********************
+ * HELPER FUNCTIONS *
+ ********************/
+
+int usage(const char *prog){
+  fprintf(stderr, "Usage: %s [command]\n", prog);
+  fprintf(stderr, "With no command, the interactive simulator starts.\n\n");
+  fprintf(stderr, "Commands:\n");
+  fprintf(stderr, "  simplify [-n size] [alg]\n");
+  fprintf(stderr, "      Prints the simplified form of alg, or of every line"
+          " of stdin if no alg is given.\n");
+  fprintf(stderr, "  replay [-n size] [-i interval] [-s move] [-q] [-p] log\n");
+  fprintf(stderr, "      Applies a move log and prints the final state. -i"
+          " writes an index with a\n      checkpoint every interval moves,"
+          " -s stops at the given move, using the\n      index if there"
+          " is one, -q hides the progress report and -p packs\n      the"
+          " stickers into three bits each to save memory on large cubes.\n");
+  fprintf(stderr, "  verify [-n size] [-j threads] [-g goal] algs states\n");
+  fprintf(stderr, "      Tries every algorithm in the algs file on every"
+          " state in the states file\n      and prints the pairs, by line,"
+          " that end up solved, or that match the\n      goal file if"
+          " one is given.\n");
+  fprintf(stderr, "  solve [-n size] [-l length] [-t seconds] [-f states]"
+          " [alg]\n");
+  fprintf(stderr, "      Prints a solution to the cube scrambled by alg, to"
+          " each state in the states\n      file, or to each scramble on"
+          " stdin. The 3x3 search stops at a solution\n      of at most"
+          " length moves or after the given time, whichever comes first.\n");
+  fprintf(stderr, "  bench [-n size] [-m moves]\n");
+  fprintf(stderr, "      Times random moves with the generic move code and"
+          " with the kernel made for\n      each size, on every size up to"
+          " %d or just the one given. Sizes small\n      enough for the"
+          " shuffle engines are also timed with each of those.\n",
+          MAX_BENCH_SIZE);
+  fprintf(stderr, "  check [-n size] [-r runs] [-m moves] [-s seed]\n");
+  fprintf(stderr, "      Runs random streams of moves through every move"
+          " engine and compares each\n      with make_move's generic code"
+          " after every move, on sizes 1 to %d or\n      just the one"
+          " given. Prints the shortest sequence that breaks an engine\n"
+          "      and how fast each one is. Then solves a few fixed scrambles"
+          " and checks\n      each solution leaves the cube exactly as new.\n",
+          MAX_BENCH_SIZE);
+  fprintf(stderr, "  comm [-n size] [-g moves] [-a len] [-b len] [-c len]"
+          " [-k pieces] [-j threads]\n");
+  fprintf(stderr, "      Prints every commutator [A, B], and conjugate"
+          " [C: [A, B]] of those, made\n      from the given moves that"
+          " moves at most the given number of pieces.\n      Results with"
+          " the same effect are only printed once.\n");
+  fprintf(stderr, "  serve [-S socket] [-j workers] [-t tables] [-l]\n");
+  fprintf(stderr, "      Keeps the solver loaded and answers requests on a"
+          " Unix socket, %s by\n      default, until sent shutdown. The"
+          " solver tables are loaded from the tables\n      file, or saved"
+          " there if it does not exist yet, and -l locks them in\n"
+          "      memory.\n", DEFAULT_SOCKET_PATH);
+  fprintf(stderr, "  call [-S socket] [request]\n");
+  fprintf(stderr, "      Sends the request, or each line of stdin, to a"
+          " running server and prints\n      the responses. Requests are"
+          " solve, apply, order or verify, followed by\n      a size and"
+          " a state or algorithm, stats, or shutdown.\n");
+  fprintf(stderr, "  recognize [-o] [-t] library [state]\n");
+  fprintf(stderr, "      Looks up the last layer case of a 3x3 with its first"
+          " two layers solved, for\n      the state given or each one on"
+          " stdin, among the cases of the algorithms\n      in the library"
+          " file, and prints it with a solution. -o only looks at\n"
+          "      orientation, as for OLL. -t times the lookups.\n");
+  return 1;
+}
+
+bool read_size_option(int argc, char **argv, int *i, int *side_len){
+  if(strcmp(argv[*i], "-n") != 0 || *i + 1 >= argc){
+    return false;
+  }
+
+  *i += 1;
+  *side_len = atoi(argv[*i]);
+  return true;
+}
+
+bool simplify_line(int side_len, const char *line){
+  alg_t *a = parse_alg(side_len, line);
+  if(a == NULL){
+    fprintf(stderr, "Invalid algorithm: %s\n", line);
+    return false;
+  }
+
+  simplify_alg(a);
+  char *str = alg_to_string(a);
+  printf("%s\n", str);
+
+  free(str);
+  free_alg(a);
+  return true;
+}
+
+int simplify_main(int argc, char **argv){
+  int side_len = 3;
+  int i = 2;
+  while(i < argc && read_size_option(argc, argv, &i, &side_len)){
+    i++;
+  }
+  if(side_len < 1){
+    fprintf(stderr, "Invalid cube size.\n");
+    return 1;
+  }
+
+  //Any remaining arguments together form the algorithm
+  if(i < argc){
+    int len = 0;
+    for(int j = i; j < argc; j++){
+      len += strlen(argv[j]) + 1;
+    }
+    char *line = Calloc(len + 1, sizeof(char));
+    for(int j = i; j < argc; j++){
+      strcat(line, argv[j]);
+      strcat(line, " ");
+    }
+
+    bool ok = simplify_line(side_len, line);
+    free(line);
+    return ok ? 0 : 1;
+  }
+
+  //Otherwise simplify stdin line by line
+  bool ok = true;
+  char line[MAX_LINE_LEN];
+  while(fgets(line, MAX_LINE_LEN, stdin) != NULL){
+    ok = simplify_line(side_len, line) && ok;
+  }
+
+  return ok ? 0 : 1;
+}
+
+int replay_main(int argc, char **argv){
+  int side_len = 3;
+  long interval = 0;
+  long seek_to = -1;
+  bool progress = true;
+  bool packed = false;
+  const char *path = NULL;
+
+  for(int i = 2; i < argc; i++){
+    if(read_size_option(argc, argv, &i, &side_len)){
+      continue;
+    }
+    else if(strcmp(argv[i], "-i") == 0 && i + 1 < argc){
+      interval = atol(argv[++i]);
+    }
+    else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc){
+      seek_to = atol(argv[++i]);
+    }
+    else if(strcmp(argv[i], "-q") == 0){
+      progress = false;
+    }
+    else if(strcmp(argv[i], "-p") == 0){
+      packed = true;
+    }
+    else{
+      path = argv[i];
+    }
+  }
+  if(path == NULL || side_len < 1){
+    return usage(argv[0]);
+  }
+
+  replay_stats_t stats;
+  state_t *s;
+  if(seek_to >= 0 && interval <= 0){
+    s = seek_log(path, side_len, seek_to, packed, &stats);
+  }
+  else{
+    s = replay_log(path, side_len, seek_to, interval, progress, packed,
+                   &stats);
+  }
+  if(s == NULL){
+    return 1;
+  }
+
+  write_state(stdout, s);
+  fprintf(stderr, "At move %ld after applying %ld moves in %.3fs",
+          stats.position, stats.moves, stats.seconds);
+  if(stats.seconds > 0){
+    fprintf(stderr, " (%.0f moves/s)", stats.moves / stats.seconds);
+  }
+  fprintf(stderr, "\n");
+  if(stats.checkpoints > 0){
+    fprintf(stderr, "Wrote %ld checkpoints\n", stats.checkpoints);
+  }
+
+  free_state(s);
+  return 0;
+}
+
+int verify_main(int argc, char **argv){
+  int side_len = 3;
+  int threads = num_cores();
+  const char *goal_path = NULL;
+  const char *paths[2] = {NULL, NULL};
+  int num_paths = 0;
+
+  for(int i = 2; i < argc; i++){
+    if(read_size_option(argc, argv, &i, &side_len)){
+      continue;
+    }
+    else if(strcmp(argv[i], "-j") == 0 && i + 1 < argc){
+      threads = atoi(argv[++i]);
+    }
+    else if(strcmp(argv[i], "-g") == 0 && i + 1 < argc){
+      goal_path = argv[++i];
+    }
+    else if(num_paths < 2){
+      paths[num_paths] = argv[i];
+      num_paths++;
+    }
+  }
+  if(num_paths < 2 || side_len < 1){
+    return usage(argv[0]);
+  }
+
+  int num_algs, num_states;
+  alg_t **algs = read_algs(paths[0], side_len, &num_algs);
+  if(algs == NULL){
+    return 1;
+  }
+  color *states = read_states(paths[1], side_len, &num_states);
+  if(states == NULL){
+    free_algs(algs, num_algs);
+    return 1;
+  }
+
+  //Without a goal file, the goal is a solved cube
+  goal_t *goal;
+  if(goal_path != NULL){
+    goal = read_goal(goal_path, side_len);
+  }
+  else{
+    color *stickers = Calloc(6 * side_len * side_len, sizeof(color));
+    state_t *solved = new_state(side_len);
+    state_export(solved, stickers);
+    goal = goal_from_stickers(side_len, stickers);
+    free_state(solved);
+    free(stickers);
+  }
+  if(goal == NULL){
+    free(states);
+    free_algs(algs, num_algs);
+    return 1;
+  }
+
+  verify_results_t *r = verify_algs(algs, num_algs, states, num_states, goal,
+                                    threads);
+  for(int i = 0; i < r->len; i++){
+    printf("%d %d\n", r->matches[i].alg + 1, r->matches[i].state + 1);
+  }
+  fprintf(stderr, "%d of %ld pairs reach the goal in %.3fs",
+          r->len, r->pairs, r->seconds);
+  if(r->seconds > 0){
+    fprintf(stderr, " (%.0f pairs/s on %d threads)",
+            r->pairs / r->seconds, r->threads);
+  }
+  fprintf(stderr, "\n");
+
+  free_verify_results(r);
+  free_goal(goal);
+  free(states);
+  free_algs(algs, num_algs);
+  return 0;
+}
+
+bool solve_one(state_t *s, const solve_options_t *opts){
+  if(state_side_len(s) != 3){
+    reduce_stats_t stats;
+    alg_t *solution = reduce_solve(s, opts, &stats);
+    if(solution == NULL){
+      printf("invalid\n");
+      return false;
+    }
+
+    char *str = alg_to_string(solution);
+    printf("%s\n", str);
+    for(int i = 0; i < NUM_REDUCE_PHASES; i++){
+      fprintf(stderr, "%-8s %6d moves in %.3fs\n", stats.phases[i].name,
+              stats.phases[i].moves, stats.phases[i].seconds);
+    }
+    fprintf(stderr, "%d moves in %.3fs after simplifying\n",
+            solution->len, stats.seconds);
+
+    free(str);
+    free_alg(solution);
+    return true;
+  }
+
+  solve_stats_t stats;
+  alg_t *solution = twophase_solve(s, opts, &stats);
+  if(solution == NULL){
+    printf("%s\n", stats.valid ? "timeout" : "invalid");
+    return false;
+  }
+
+  char *str = alg_to_string(solution);
+  printf("%s\n", str);
+  fprintf(stderr, "%d moves in %.3fs (%ld nodes)\n",
+          solution->len, stats.seconds, stats.nodes);
+
+  free(str);
+  free_alg(solution);
+  return true;
+}
+
+int solve_main(int argc, char **argv){
+  solve_options_t opts = default_solve_options();
+  const char *states_path = NULL;
+  int side_len = 3;
+  int i = 2;
+  for(; i < argc; i++){
+    if(read_size_option(argc, argv, &i, &side_len)){
+      continue;
+    }
+    else if(strcmp(argv[i], "-l") == 0 && i + 1 < argc){
+      opts.max_length = atoi(argv[++i]);
+    }
+    else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc){
+      opts.timeout = atof(argv[++i]);
+    }
+    else if(strcmp(argv[i], "-f") == 0 && i + 1 < argc){
+      states_path = argv[++i];
+    }
+    else{
+      break;
+    }
+  }
+  if(side_len < 1){
+    fprintf(stderr, "Invalid cube size.\n");
+    return 1;
+  }
+
+  //Build the tables first so that the times reported are for the search
+  double start = get_time();
+  twophase_init();
+  reduce_init();
+  fprintf(stderr, "Built tables in %.3fs\n", get_time() - start);
+
+  bool ok = true;
+  if(states_path != NULL){
+    int num_states;
+    color *states = read_states(states_path, side_len, &num_states);
+    if(states == NULL){
+      return 1;
+    }
+
+    for(int j = 0; j < num_states; j++){
+      long offset = (long) j * 6 * side_len * side_len;
+      state_t *s = state_import(side_len, states + offset);
+      ok = solve_one(s, &opts) && ok;
+      free_state(s);
+    }
+    free(states);
+    return ok ? 0 : 1;
+  }
+
+  //Any remaining arguments together form the scramble, as in simplify
+  char line[MAX_LINE_LEN] = "";
+  bool from_stdin = i >= argc;
+  for(int j = i; j < argc; j++){
+    if(strlen(line) + strlen(argv[j]) + 2 > MAX_LINE_LEN){
+      fprintf(stderr, "Scramble too long.\n");
+      return 1;
+    }
+    strcat(line, argv[j]);
+    strcat(line, " ");
+  }
+
+  while(!from_stdin || fgets(line, MAX_LINE_LEN, stdin) != NULL){
+    alg_t *a = parse_alg(side_len, line);
+    if(a == NULL){
+      fprintf(stderr, "Invalid algorithm: %s\n", line);
+      ok = false;
+    }
+    else{
+      state_t *s = new_state(side_len);
+      for(int j = 0; j < a->len; j++){
+        apply_move(s, a->moves[j]);
+      }
+      ok = solve_one(s, &opts) && ok;
+      free_state(s);
+      free_alg(a);
+    }
+
+    if(!from_stdin){
+      break;
+    }
+  }
+
+  return ok ? 0 : 1;
+}
+
+double time_moves(state_t *s, const move_t *moves, long count){
+  double start = get_time();
+  for(long i = 0; i < count; i++){
+    apply_move(s, moves[i]);
+  }
+  return get_time() - start;
+}
+
+bool bench_size(int side_len, long count){
+  move_t *moves = Calloc(count, sizeof(move_t));
+  for(long i = 0; i < count; i++){
+    moves[i].face = rand() % 6;
+    moves[i].depth = rand() % side_len;
+    moves[i].turns = 1 + rand() % 3;
+  }
+
+  state_t *generic = new_state(side_len);
+  state_t *specialized = new_state(side_len);
+  state_set_kernel(generic, false);
+  double generic_time = time_moves(generic, moves, count);
+  double specialized_time = time_moves(specialized, moves, count);
+  bool ok = state_equal(generic, specialized);
+
+  printf("%4d %12.0f %12.0f %8.2fx\n", side_len,
+         count / generic_time, count / specialized_time,
+         generic_time / specialized_time);
+  if(!ok){
+    fprintf(stderr, "The kernel for size %d disagrees with the generic"
+            " code!\n", side_len);
+  }
+
+  for(int i = 0; i < NUM_SHUFFLE_ENGINES && shuffle_supported(side_len); i++){
+    if(shuffle_engine_supported(i)){
+      ok = bench_shuffle(i, moves, count, generic_time, generic) && ok;
+    }
+  }
+
+  if(state_can_pack(side_len)){
+    state_t *packed = new_state(side_len);
+    state_set_packed(packed, true);
+    double packed_time = time_moves(packed, moves, count);
+    printf("     %-7s %12.0f %8.2fx  %zu bytes instead of %zu\n", "packed",
+           count / packed_time, generic_time / packed_time,
+           state_bytes(packed), state_bytes(generic));
+    if(!state_equal(packed, generic)){
+      fprintf(stderr, "The packed state for size %d disagrees with the"
+              " generic code!\n", side_len);
+      ok = false;
+    }
+    free_state(packed);
+  }
+
+  free_state(generic);
+  free_state(specialized);
+  free(moves);
+  return ok;
+}
+
+bool bench_shuffle(int engine,
+                   const move_t *moves,
+                   long count,
+                   double generic_time,
+                   state_t *expected){
+  int side_len = state_side_len(expected);
+  int previous = shuffle_current_engine();
+  shuffle_use_engine(engine);
+
+  shuffle_cube_t c;
+  state_t *s = new_state(side_len);
+  shuffle_load(&c, s);
+  free_state(s);
+
+  double start = get_time();
+  for(long i = 0; i < count; i++){
+    shuffle_move(&c, moves[i]);
+  }
+  double seconds = get_time() - start;
+  shuffle_use_engine(previous);
+
+  s = shuffle_store(&c);
+  bool ok = state_equal(s, expected);
+  free_state(s);
+
+  printf("     %-7s %12.0f %8.2fx\n", shuffle_engine_name(engine),
+         count / seconds, generic_time / seconds);
+  if(!ok){
+    fprintf(stderr, "The %s shuffle for size %d disagrees with the generic"
+            " code!\n", shuffle_engine_name(engine), side_len);
+  }
+
+  return ok;
+}
+
+int bench_main(int argc, char **argv){
+  int side_len = 0;
+  long count = DEFAULT_BENCH_MOVES;
+  for(int i = 2; i < argc; i++){
+    if(read_size_option(argc, argv, &i, &side_len)){
+      continue;
+    }
+    else if(strcmp(argv[i], "-m") == 0 && i + 1 < argc){
+      count = atol(argv[++i]);
+    }
+    else{
+      return usage(argv[0]);
+    }
+  }
+  if(side_len < 0 || count < 1){
+    return usage(argv[0]);
+  }
+
+  //Sizes without a kernel of their own compare the generic code to itself
+  printf("size    generic/s     kernel/s  speedup\n");
+  bool ok = true;
+  int first = side_len > 0 ? side_len : 1;
+  int last = side_len > 0 ? side_len : MAX_BENCH_SIZE;
+  for(int n = first; n <= last; n++){
+    ok = bench_size(n, count) && ok;
+  }
+
+  return ok ? 0 : 1;
+}
+
+void print_check_results(check_results_t *r){
+  printf("size engine               moves/s  vs reference\n");
+  for(int n = r->opts.min_size; n <= r->opts.max_size; n++){
+    engine_result_t *results = r->engines[n];
+    double reference = results[ENGINE_REFERENCE].moves_per_second;
+
+    for(int e = 0; e < NUM_ENGINES; e++){
+      if(!results[e].available){
+        continue;
+      }
+      printf("%4d %-16s %12.0f %12.2fx", n, check_engine_name(e),
+             results[e].moves_per_second,
+             reference > 0 ? results[e].moves_per_second / reference : 0);
+      if(results[e].failures > 0){
+        printf("  FAILED %ld of %d runs", results[e].failures, r->opts.runs);
+      }
+      printf("\n");
+    }
+  }
+
+  for(int n = r->opts.min_size; n <= r->opts.max_size; n++){
+    for(int e = 0; e < NUM_ENGINES; e++){
+      alg_t *repro = r->engines[n][e].repro;
+      if(repro != NULL){
+        char *str = alg_to_string(repro);
+        printf("%s disagrees on a %dx%d after: %s\n",
+               check_engine_name(e), n, n, str);
+        free(str);
+      }
+    }
+  }
+}
+
+int check_main(int argc, char **argv){
+  check_options_t opts = {1, MAX_BENCH_SIZE,
+                          DEFAULT_CHECK_RUNS, DEFAULT_CHECK_MOVES, 1};
+  int side_len = 0;
+  for(int i = 2; i < argc; i++){
+    if(read_size_option(argc, argv, &i, &side_len)){
+      continue;
+    }
+    else if(strcmp(argv[i], "-r") == 0 && i + 1 < argc){
+      opts.runs = atoi(argv[++i]);
+    }
+    else if(strcmp(argv[i], "-m") == 0 && i + 1 < argc){
+      opts.moves = atoi(argv[++i]);
+    }
+    else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc){
+      opts.seed = strtoul(argv[++i], NULL, 10);
+    }
+    else{
+      return usage(argv[0]);
+    }
+  }
+  if(side_len > 0){
+    opts.min_size = side_len;
+    opts.max_size = side_len;
+  }
+
+  double start = get_time();
+  check_results_t *r = run_checks(&opts);
+  if(r == NULL){
+    return usage(argv[0]);
+  }
+
+  print_check_results(r);
+  bool ok = checks_passed(r);
+  fprintf(stderr, "Compared %ld moves in %.3fs: %s\n", r->steps,
+          get_time() - start, ok ? "all engines agree" : "MISMATCH");
+
+  start = get_time();
+  int failures = check_solvers();
+  fprintf(stderr, "Checked the solvers in %.3fs: %s\n", get_time() - start,
+          failures == 0 ? "every scramble solved" : "FAILED");
+  ok = ok && failures == 0;
+
+  free_check_results(r);
+  return ok ? 0 : 1;
+}
+
+alg_t *default_generators(int side_len){
+  alg_t *ret = new_alg(side_len);
+  const int faces[] = {2, 3, 5};
+  for(int depth = 0; depth < (side_len + 1) / 2; depth++){
+    for(int i = 0; i < 3; i++){
+      move_t m = {faces[i], depth, 1};
+      alg_append(ret, m);
+    }
+  }
+
+  return ret;
+}
+
+int comm_main(int argc, char **argv){
+  comm_options_t opts = {NULL, DEFAULT_COMM_A, DEFAULT_COMM_B, DEFAULT_COMM_C,
+                         DEFAULT_COMM_PIECES, num_cores()};
+  int side_len = DEFAULT_COMM_SIZE;
+  const char *generators = NULL;
+  for(int i = 2; i < argc; i++){
+    if(read_size_option(argc, argv, &i, &side_len)){
+      continue;
+    }
+    else if(strcmp(argv[i], "-g") == 0 && i + 1 < argc){
+      generators = argv[++i];
+    }
+    else if(strcmp(argv[i], "-a") == 0 && i + 1 < argc){
+      opts.max_a = atoi(argv[++i]);
+    }
+    else if(strcmp(argv[i], "-b") == 0 && i + 1 < argc){
+      opts.max_b = atoi(argv[++i]);
+    }
+    else if(strcmp(argv[i], "-c") == 0 && i + 1 < argc){
+      opts.max_c = atoi(argv[++i]);
+    }
+    else if(strcmp(argv[i], "-k") == 0 && i + 1 < argc){
+      opts.max_pieces = atoi(argv[++i]);
+    }
+    else if(strcmp(argv[i], "-j") == 0 && i + 1 < argc){
+      opts.threads = atoi(argv[++i]);
+    }
+    else{
+      return usage(argv[0]);
+    }
+  }
+  if(side_len < 2){
+    fprintf(stderr, "Invalid cube size.\n");
+    return 1;
+  }
+
+  if(generators != NULL){
+    opts.generators = parse_alg(side_len, generators);
+    if(opts.generators == NULL){
+      fprintf(stderr, "Invalid moves: %s\n", generators);
+      return 1;
+    }
+  }
+  else{
+    opts.generators = default_generators(side_len);
+  }
+
+  comm_stats_t stats;
+  bool ok = find_comms(&opts, stdout, &stats);
+  free_alg(opts.generators);
+  if(!ok){
+    return usage(argv[0]);
+  }
+
+  fprintf(stderr, "Found %ld of %ld candidates from %d sequences in %.3fs"
+          " on %d threads, skipping %ld duplicates\n", stats.found,
+          stats.candidates, stats.sequences, stats.seconds, stats.threads,
+          stats.duplicates);
+  return 0;
+}
+
+int serve_main(int argc, char **argv){
+  serve_options_t opts = {DEFAULT_SOCKET_PATH, NULL, false, num_cores()};
+  for(int i = 2; i < argc; i++){
+    if(strcmp(argv[i], "-S") == 0 && i + 1 < argc){
+      opts.socket_path = argv[++i];
+    }
+    else if(strcmp(argv[i], "-j") == 0 && i + 1 < argc){
+      opts.workers = atoi(argv[++i]);
+    }
+    else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc){
+      opts.tables_path = argv[++i];
+    }
+    else if(strcmp(argv[i], "-l") == 0){
+      opts.lock_tables = true;
+    }
+    else{
+      return usage(argv[0]);
+    }
+  }
+
+  return serve(&opts);
+}
+
+bool call_one(int fd, const char *request){
+  if(!send_message(fd, request, strlen(request))){
+    fprintf(stderr, "Lost the connection to the server\n");
+    return false;
+  }
+
+  char *response = recv_message(fd);
+  if(response == NULL){
+    fprintf(stderr, "Lost the connection to the server\n");
+    return false;
+  }
+
+  printf("%s\n", response);
+  bool ok = strncmp(response, "ok", 2) == 0;
+  free(response);
+  return ok;
+}
+
+int call_main(int argc, char **argv){
+  const char *path = DEFAULT_SOCKET_PATH;
+  int i = 2;
+  if(i + 1 < argc && strcmp(argv[i], "-S") == 0){
+    path = argv[i + 1];
+    i += 2;
+  }
+
+  int fd = connect_server(path);
+  if(fd < 0){
+    fprintf(stderr, "No server is listening on %s\n", path);
+    return 1;
+  }
+
+  //The rest of the arguments make up a single request
+  bool ok = true;
+  if(i < argc){
+    size_t len = 0;
+    for(int j = i; j < argc; j++){
+      len += strlen(argv[j]) + 1;
+    }
+    char *request = Calloc(len, sizeof(char));
+    for(int j = i; j < argc; j++){
+      strcat(request, argv[j]);
+      if(j + 1 < argc){
+        strcat(request, " ");
+      }
+    }
+    ok = call_one(fd, request);
+    free(request);
+  }
+  else{
+    char line[MAX_LINE_LEN];
+    while(fgets(line, sizeof(line), stdin) != NULL){
+      line[strcspn(line, "\r\n")] = '\0';
+      if(line[0] != '\0'){
+        ok = call_one(fd, line) && ok;
+      }
+    }
+  }
+
+  close(fd);
+  return ok ? 0 : 1;
+}
+
+bool recognize_one(case_table_t *t, const char *line, double *seconds){
+  color stickers[6 * 3 * 3];
+  if(!parse_state(line, 3, stickers)){
+    fprintf(stderr, "Invalid state: %s\n", line);
+    return false;
+  }
+
+  state_t *s = state_import(3, stickers);
+  ll_match_t match;
+  bool found = recognize_ll(t, s, &match);
+
+  //A single lookup is too quick to time on its own
+  if(seconds != NULL){
+    ll_match_t timed;
+    double start = get_time();
+    for(int i = 0; i < RECOGNIZE_REPEATS; i++){
+      recognize_ll(t, s, &timed);
+    }
+    *seconds += (get_time() - start) / RECOGNIZE_REPEATS;
+  }
+  free_state(s);
+
+  if(!found){
+    printf("unknown\n");
+    return false;
+  }
+
+  alg_t *solution = case_solution(t, &match, 0);
+  char *str = alg_to_string(solution);
+  printf("%s: %s\n", match.name, str);
+  free(str);
+  free_alg(solution);
+  return true;
+}
+
+int recognize_main(int argc, char **argv){
+  bool orientation_only = false;
+  bool timed = false;
+  int i = 2;
+  for(; i < argc; i++){
+    if(strcmp(argv[i], "-o") == 0){
+      orientation_only = true;
+    }
+    else if(strcmp(argv[i], "-t") == 0){
+      timed = true;
+    }
+    else{
+      break;
+    }
+  }
+  if(i >= argc){
+    return usage(argv[0]);
+  }
+
+  case_table_t *t = load_cases(argv[i], orientation_only);
+  if(t == NULL){
+    return 1;
+  }
+  i++;
+
+  int found = 0;
+  int total = 0;
+  double seconds = 0;
+  double *timing = timed ? &seconds : NULL;
+  if(i < argc){
+    size_t len = 0;
+    for(int j = i; j < argc; j++){
+      len += strlen(argv[j]) + 1;
+    }
+    char *line = Calloc(len, sizeof(char));
+    for(int j = i; j < argc; j++){
+      strcat(line, argv[j]);
+      if(j + 1 < argc){
+        strcat(line, " ");
+      }
+    }
+    found += recognize_one(t, line, timing);
+    total++;
+    free(line);
+  }
+  else{
+    char line[MAX_LINE_LEN];
+    while(fgets(line, sizeof(line), stdin) != NULL){
+      line[strcspn(line, "\r\n")] = '\0';
+      if(line[0] != '\0'){
+        found += recognize_one(t, line, timing);
+        total++;
+      }
+    }
+  }
+
+  fprintf(stderr, "Recognized %d of %d states among %d cases\n", found,
+          total, num_cases(t));
+  if(timed && total > 0){
+    fprintf(stderr, "%.0fns per lookup\n", seconds / total * 1e9);
+  }
+  free_cases(t);
+  return found == total ? 0 : 1;
+}
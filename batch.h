@@ -0,0 +1,10 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+/* Runs one of the non-interactive commands named by argv[1] and returns the
+ * exit status for the program. Used when the program is given arguments,
+ * instead of starting the ncurses interface.
+ */
+int batch_main(int argc, char **argv);
+
+#endif
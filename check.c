@@ -0,0 +1,520 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "alg.h"
+#include "check.h"
+#include "helpers.h"
+#include "perm.h"
+#include "reduce.h"
+#include "shuffle.h"
+#include "state.h"
+#include "twophase.h"
+
+#define NUM_FACES 6
+
+/* A scramble check_solvers solves, and the most moves its solution may take,
+ * or -1 if the solver is only expected to solve it.
+ */
+typedef struct solver_case_t{
+  int side_len;
+  const char *scramble;
+  int max_len;
+} solver_case_t;
+
+static const solver_case_t SOLVER_CASES[] = {
+  {3, "R", 1},
+  {3, "R U", 2},
+  {3, "R U F", 3},
+  {3, "F B", 2},
+  {3, "U D2", 2},
+  {3, "F B R", 3},
+  {2, "R U F' U2 R'", -1},
+  {4, "R U 2R", -1},
+  {4, "R 2U F' 2F2 L B'", -1},
+  {5, "R 2U F' 2F2 L B' 3R", -1},
+  {6, "R 2U 3F' 2F2 L B'", -1},
+  {10, "R 2U 3F' 4F2 5L B'", -1}
+};
+
+#define NUM_SOLVER_CASES (sizeof(SOLVER_CASES) / sizeof(SOLVER_CASES[0]))
+
+/* One engine's cube, whichever way that engine keeps it.
+ */
+typedef struct runner_t{
+  int engine;
+  int side_len;
+  state_t *s;                 //For the engines built on state_t
+  shuffle_cube_t cube;        //For the shuffle engines
+  color *stickers;            //For the compiled moves, with room to swap
+  color *scratch;
+  perm_t **perms;             //Every move compiled, indexed by perm_index
+} runner_t;
+
+/******************************
+ * HELPER FUNCTION PROTOTYPES *
+ ******************************/
+
+/* Returns true if the given engine handles cubes of the given size.
+ */
+bool engine_available(int engine, int side_len);
+
+/* Sets up r as a solved cube of the given size for the given engine, which
+ * must be available.
+ */
+void runner_start(runner_t *r, int engine, int side_len);
+
+/* Makes the move m on r's cube.
+ */
+void runner_move(runner_t *r, move_t m);
+
+/* Writes out r's stickers the way state_export does.
+ */
+void runner_export(runner_t *r, color *out);
+
+/* Frees everything runner_start set up.
+ */
+void runner_free(runner_t *r);
+
+/* Returns the index into a runner's perms of the given move.
+ */
+int perm_index(move_t m, int side_len);
+
+/* Fills moves with len random moves for the given size.
+ */
+void random_moves(move_t *moves, int len, int side_len);
+
+/* Returns the number of the first move after which engine disagrees with the
+ * reference, or -1 if it never does.
+ */
+int first_disagreement(int engine, int side_len, const move_t *moves, int len);
+
+/* Returns the shortest sequence of moves from the len given that still makes
+ * engine disagree with the reference. Every single move is tried on its own
+ * first, then ever smaller runs of moves are taken out for as long as the
+ * disagreement survives.
+ */
+alg_t *minimize(int engine, int side_len, const move_t *moves, int len);
+
+/* Times the given engine on moves and returns how many it makes a second.
+ */
+double time_engine(int engine, int side_len, const move_t *moves, int len);
+
+/* Solves one of SOLVER_CASES, printing what went wrong if it failed.
+ */
+bool check_solver(const solver_case_t *c);
+
+/****************************
+ * FUNCTION IMPLEMENTATIONS *
+ ****************************/
+
+const char *check_engine_name(int engine){
+  static const char *names[NUM_ENGINES] = {
+    "reference", "apply_move", "kernel", "make_move", "perm", "packed",
+    "packed/make_move", "shuffle/scalar", "shuffle/pshufb", "shuffle/vpermb"
+  };
+
+  if(engine < 0 || engine >= NUM_ENGINES){
+    return "unknown";
+  }
+  return names[engine];
+}
+
+check_results_t *run_checks(const check_options_t *opts){
+  if(opts == NULL || opts->min_size < 1 || opts->max_size > MAX_CHECK_SIZE
+     || opts->min_size > opts->max_size || opts->runs < 1 || opts->moves < 1){
+    return NULL;
+  }
+
+  check_results_t *ret = Calloc(1, sizeof(check_results_t));
+  ret->opts = *opts;
+  srand(opts->seed);
+  shuffle_init();
+  int previous_shuffle = shuffle_current_engine();
+
+  move_t *moves = Calloc(opts->moves, sizeof(move_t));
+  for(int n = opts->min_size; n <= opts->max_size; n++){
+    engine_result_t *results = ret->engines[n];
+    int face_len = NUM_FACES * n * n;
+    color *expected = Calloc(face_len, sizeof(color));
+    color *actual = Calloc(face_len, sizeof(color));
+    for(int e = 0; e < NUM_ENGINES; e++){
+      results[e].available = engine_available(e, n);
+    }
+
+    for(int run = 0; run < opts->runs; run++){
+      random_moves(moves, opts->moves, n);
+
+      runner_t runners[NUM_ENGINES];
+      bool failed[NUM_ENGINES] = {false};
+      for(int e = 0; e < NUM_ENGINES; e++){
+        if(results[e].available){
+          runner_start(&runners[e], e, n);
+        }
+      }
+
+      for(int i = 0; i < opts->moves; i++){
+        runner_move(&runners[ENGINE_REFERENCE], moves[i]);
+        runner_export(&runners[ENGINE_REFERENCE], expected);
+        ret->steps++;
+
+        for(int e = ENGINE_REFERENCE + 1; e < NUM_ENGINES; e++){
+          if(!results[e].available || failed[e]){
+            continue;
+          }
+
+          runner_move(&runners[e], moves[i]);
+          runner_export(&runners[e], actual);
+          if(memcmp(expected, actual, face_len) == 0){
+            continue;
+          }
+
+          //Keep the shortest sequence found over every run
+          failed[e] = true;
+          results[e].failures++;
+          alg_t *repro = minimize(e, n, moves, i + 1);
+          if(results[e].repro == NULL || repro->len < results[e].repro->len){
+            free_alg(results[e].repro);
+            results[e].repro = repro;
+          }
+          else{
+            free_alg(repro);
+          }
+        }
+      }
+
+      for(int e = 0; e < NUM_ENGINES; e++){
+        if(results[e].available){
+          runner_free(&runners[e]);
+        }
+      }
+    }
+
+    //One more stream, only for timing
+    random_moves(moves, opts->moves, n);
+    for(int e = 0; e < NUM_ENGINES; e++){
+      if(results[e].available){
+        results[e].moves_per_second = time_engine(e, n, moves, opts->moves);
+      }
+    }
+
+    free(expected);
+    free(actual);
+  }
+
+  shuffle_use_engine(previous_shuffle);
+  free(moves);
+  return ret;
+}
+
+bool checks_passed(check_results_t *r){
+  for(int n = r->opts.min_size; n <= r->opts.max_size; n++){
+    for(int e = 0; e < NUM_ENGINES; e++){
+      if(r->engines[n][e].failures > 0){
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+void free_check_results(check_results_t *r){
+  if(r == NULL){
+    return;
+  }
+
+  for(int n = 0; n <= MAX_CHECK_SIZE; n++){
+    for(int e = 0; e < NUM_ENGINES; e++){
+      free_alg(r->engines[n][e].repro);
+    }
+  }
+  free(r);
+}
+
+int check_solvers(){
+  int failures = 0;
+  for(size_t i = 0; i < NUM_SOLVER_CASES; i++){
+    failures += !check_solver(&SOLVER_CASES[i]);
+  }
+
+  return failures;
+}
+
+/********************
+ * HELPER FUNCTIONS *
+ ********************/
+
+bool check_solver(const solver_case_t *c){
+  alg_t *scramble = parse_alg(c->side_len, c->scramble);
+  state_t *s = new_state(c->side_len);
+  for(int i = 0; i < scramble->len; i++){
+    apply_move(s, scramble->moves[i]);
+  }
+  free_alg(scramble);
+
+  alg_t *solution = c->side_len == 3 ? twophase_solve(s, NULL, NULL)
+                                     : reduce_solve(s, NULL, NULL);
+  bool ok = solution != NULL;
+  for(int i = 0; ok && i < solution->len; i++){
+    apply_move(s, solution->moves[i]);
+  }
+
+  //Solved means exactly like a new cube, not solved but turned as a whole
+  state_t *solved = new_state(c->side_len);
+  if(!ok){
+    fprintf(stderr, "No solution for %s on a %dx%d\n", c->scramble,
+            c->side_len, c->side_len);
+  }
+  else if(!state_equal(s, solved)){
+    fprintf(stderr, "Solution for %s on a %dx%d does not solve it\n",
+            c->scramble, c->side_len, c->side_len);
+    ok = false;
+  }
+  else if(c->max_len >= 0 && solution->len > c->max_len){
+    char *str = alg_to_string(solution);
+    fprintf(stderr, "Solution for %s on a %dx%d takes %d moves: %s\n",
+            c->scramble, c->side_len, c->side_len, solution->len, str);
+    free(str);
+    ok = false;
+  }
+
+  free_state(solved);
+  free_state(s);
+  free_alg(solution);
+  return ok;
+}
+
+bool engine_available(int engine, int side_len){
+  switch(engine){
+  case ENGINE_REFERENCE:
+  case ENGINE_GENERIC:
+  case ENGINE_PERM:
+    return true;
+  case ENGINE_PACKED:
+  case ENGINE_PACKED_MAKE_MOVE:
+    return state_can_pack(side_len);
+  case ENGINE_KERNEL:
+  case ENGINE_MAKE_MOVE:
+    return state_has_kernel(side_len);
+  default:
+    return shuffle_supported(side_len)
+      && shuffle_engine_supported(engine - ENGINE_SHUFFLE);
+  }
+}
+
+void runner_start(runner_t *r, int engine, int side_len){
+  memset(r, 0, sizeof(runner_t));
+  r->engine = engine;
+  r->side_len = side_len;
+  r->s = new_state(side_len);
+
+  switch(engine){
+  case ENGINE_REFERENCE:
+  case ENGINE_GENERIC:
+    state_set_kernel(r->s, false);
+    break;
+  case ENGINE_PERM:{
+    int num_perms = NUM_FACES * side_len * 3;
+    r->perms = Calloc(num_perms, sizeof(perm_t *));
+    for(int face = 0; face < NUM_FACES; face++){
+      for(int depth = 0; depth < side_len; depth++){
+        for(int turns = 1; turns <= 3; turns++){
+          move_t m = {face, depth, turns};
+          alg_t *a = new_alg(side_len);
+          alg_append(a, m);
+          r->perms[perm_index(m, side_len)] = compile_alg(a);
+          free_alg(a);
+        }
+      }
+    }
+
+    int face_len = NUM_FACES * side_len * side_len;
+    r->stickers = Calloc(face_len, sizeof(color));
+    r->scratch = Calloc(face_len, sizeof(color));
+    state_export(r->s, r->stickers);
+    break;
+  }
+  case ENGINE_KERNEL:
+  case ENGINE_MAKE_MOVE:
+    break;
+  case ENGINE_PACKED:
+  case ENGINE_PACKED_MAKE_MOVE:
+    state_set_packed(r->s, true);
+    break;
+  default:
+    shuffle_load(&r->cube, r->s);
+    break;
+  }
+}
+
+void runner_move(runner_t *r, move_t m){
+  switch(r->engine){
+  case ENGINE_REFERENCE:
+  case ENGINE_MAKE_MOVE:
+  case ENGINE_PACKED_MAKE_MOVE:{
+    char str[MAX_MOVE_STR_LEN];
+    move_to_string(m, str);
+    state_t *next = make_move(r->s, str);
+    free_state(r->s);
+    r->s = next;
+    break;
+  }
+  case ENGINE_GENERIC:
+  case ENGINE_KERNEL:
+  case ENGINE_PACKED:
+    apply_move(r->s, m);
+    break;
+  case ENGINE_PERM:{
+    apply_perm(r->perms[perm_index(m, r->side_len)], r->stickers, r->scratch);
+    color *temp = r->stickers;
+    r->stickers = r->scratch;
+    r->scratch = temp;
+    break;
+  }
+  default:
+    //Every shuffle runner shares the one engine setting
+    shuffle_use_engine(r->engine - ENGINE_SHUFFLE);
+    shuffle_move(&r->cube, m);
+    break;
+  }
+}
+
+void runner_export(runner_t *r, color *out){
+  int face_len = NUM_FACES * r->side_len * r->side_len;
+  switch(r->engine){
+  case ENGINE_PERM:
+    memcpy(out, r->stickers, face_len);
+    break;
+  case ENGINE_REFERENCE:
+  case ENGINE_GENERIC:
+  case ENGINE_KERNEL:
+  case ENGINE_MAKE_MOVE:
+  case ENGINE_PACKED:
+  case ENGINE_PACKED_MAKE_MOVE:
+    state_export(r->s, out);
+    break;
+  default:
+    memcpy(out, r->cube.stickers, face_len);
+    break;
+  }
+}
+
+void runner_free(runner_t *r){
+  if(r->perms != NULL){
+    for(int i = 0; i < NUM_FACES * r->side_len * 3; i++){
+      free_perm(r->perms[i]);
+    }
+    free(r->perms);
+  }
+  free(r->stickers);
+  free(r->scratch);
+  free_state(r->s);
+}
+
+int perm_index(move_t m, int side_len){
+  return (m.face * side_len + m.depth) * 3 + m.turns - 1;
+}
+
+void random_moves(move_t *moves, int len, int side_len){
+  for(int i = 0; i < len; i++){
+    moves[i].face = rand() % NUM_FACES;
+    moves[i].depth = rand() % side_len;
+    moves[i].turns = 1 + rand() % 3;
+  }
+}
+
+int first_disagreement(int engine, int side_len, const move_t *moves, int len){
+  int face_len = NUM_FACES * side_len * side_len;
+  color *expected = Calloc(face_len, sizeof(color));
+  color *actual = Calloc(face_len, sizeof(color));
+  runner_t reference, tested;
+  runner_start(&reference, ENGINE_REFERENCE, side_len);
+  runner_start(&tested, engine, side_len);
+
+  int ret = -1;
+  for(int i = 0; i < len && ret < 0; i++){
+    runner_move(&reference, moves[i]);
+    runner_move(&tested, moves[i]);
+    runner_export(&reference, expected);
+    runner_export(&tested, actual);
+    if(memcmp(expected, actual, face_len) != 0){
+      ret = i;
+    }
+  }
+
+  runner_free(&reference);
+  runner_free(&tested);
+  free(expected);
+  free(actual);
+  return ret;
+}
+
+alg_t *minimize(int engine, int side_len, const move_t *moves, int len){
+  alg_t *ret = new_alg(side_len);
+
+  //Nothing is shorter than a single move
+  for(int i = 0; i < len; i++){
+    if(first_disagreement(engine, side_len, moves + i, 1) == 0){
+      alg_append(ret, moves[i]);
+      return ret;
+    }
+  }
+
+  move_t *seq = Calloc(len, sizeof(move_t));
+  move_t *trial = Calloc(len, sizeof(move_t));
+  memcpy(seq, moves, len * sizeof(move_t));
+  int seq_len = len;
+
+  for(int chunk = seq_len / 2; chunk >= 1; chunk /= 2){
+    int start = 0;
+    while(start + chunk <= seq_len && seq_len > chunk){
+      //Try it without moves start to start + chunk
+      int trial_len = seq_len - chunk;
+      memcpy(trial, seq, start * sizeof(move_t));
+      memcpy(trial + start, seq + start + chunk,
+             (seq_len - start - chunk) * sizeof(move_t));
+
+      int at = first_disagreement(engine, side_len, trial, trial_len);
+      if(at >= 0){
+        //Anything after the disagreement is not needed either
+        memcpy(seq, trial, (at + 1) * sizeof(move_t));
+        seq_len = at + 1;
+      }
+      else{
+        start += chunk;
+      }
+    }
+  }
+
+  for(int i = 0; i < seq_len; i++){
+    alg_append(ret, seq[i]);
+  }
+  free(seq);
+  free(trial);
+  return ret;
+}
+
+double time_engine(int engine, int side_len, const move_t *moves, int len){
+  runner_t r;
+  runner_start(&r, engine, side_len);
+
+  //The shuffle engines are set once, so that is not part of the time
+  bool shuffle = engine >= ENGINE_SHUFFLE;
+  if(shuffle){
+    shuffle_use_engine(engine - ENGINE_SHUFFLE);
+  }
+
+  double start = get_time();
+  for(int i = 0; i < len; i++){
+    if(shuffle){
+      shuffle_move(&r.cube, moves[i]);
+    }
+    else{
+      runner_move(&r, moves[i]);
+    }
+  }
+  double seconds = get_time() - start;
+
+  runner_free(&r);
+  return seconds > 0 ? len / seconds : 0;
+}
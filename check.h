@@ -0,0 +1,81 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdbool.h>
+#include "alg.h"
+#include "shuffle.h"
+
+#define MAX_CHECK_SIZE 16
+
+/* The engines checked against the reference, which is make_move on a cube
+ * using the generic code, the way every move was made before any of the
+ * others existed.
+ */
+#define ENGINE_REFERENCE 0
+#define ENGINE_GENERIC 1        //apply_move without a kernel
+#define ENGINE_KERNEL 2         //apply_move with the kernel for the size
+#define ENGINE_MAKE_MOVE 3      //make_move with the kernel for the size
+#define ENGINE_PERM 4           //Each move compiled with compile_alg
+#define ENGINE_PACKED 5         //apply_move on a packed state
+#define ENGINE_PACKED_MAKE_MOVE 6   //make_move on a packed state
+#define ENGINE_SHUFFLE 7        //Plus the engine number, from shuffle.h
+#define NUM_ENGINES (ENGINE_SHUFFLE + NUM_SHUFFLE_ENGINES)
+
+/* What run_checks should do: on every size from min_size to max_size, try
+ * runs streams of that many random moves each, generated from seed.
+ */
+typedef struct check_options_t{
+  int min_size;
+  int max_size;
+  int runs;
+  int moves;
+  unsigned seed;
+} check_options_t;
+
+/* How one engine did on one size. available is false if the engine does not
+ * handle that size at all. repro is the shortest sequence of moves found that
+ * makes it disagree with the reference, or NULL if it never did.
+ */
+typedef struct engine_result_t{
+  bool available;
+  long failures;
+  alg_t *repro;
+  double moves_per_second;
+} engine_result_t;
+
+/* Everything run_checks found, indexed by size and then engine.
+ */
+typedef struct check_results_t{
+  check_options_t opts;
+  long steps;
+  engine_result_t engines[MAX_CHECK_SIZE + 1][NUM_ENGINES];
+} check_results_t;
+
+/* Returns the name of the given engine.
+ */
+const char *check_engine_name(int engine);
+
+/* Drives random streams of moves through every engine that handles each size
+ * and compares their stickers with the reference after every move. A stream
+ * that makes an engine disagree is cut down to as few moves as still do.
+ * Afterwards every engine is timed on one more stream of the same length.
+ * Returns NULL if the options are invalid.
+ */
+check_results_t *run_checks(const check_options_t *opts);
+
+/* Returns true if no engine disagreed with the reference.
+ */
+bool checks_passed(check_results_t *r);
+
+/* Frees the results of run_checks.
+ */
+void free_check_results(check_results_t *r);
+
+/* Solves a fixed set of scrambles on cubes of several sizes, checking that
+ * each solution leaves the cube exactly like new_state, and that the
+ * solutions to short 3x3 scrambles are no longer than the scrambles.
+ * Prints each failure to stderr and returns how many there were.
+ */
+int check_solvers();
+
+#endif
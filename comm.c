@@ -0,0 +1,542 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "alg.h"
+#include "comm.h"
+#include "cubie.h"
+#include "helpers.h"
+#include "perm.h"
+
+#define NUM_FACES 6
+#define MAX_SEQUENCES 200000
+#define MAX_NOTATION_LEN 1024
+
+/* A sequence of moves and where it takes every sticker, as in perm_t: after
+ * the moves, position p holds the sticker that started at src[p]. inv is the
+ * same for the inverse of the sequence.
+ */
+typedef struct sequence_t{
+  alg_t *alg;
+  int *src;
+  int *inv;
+} sequence_t;
+
+/* Every effect found so far, as an open addressing hash set of the src
+ * arrays.
+ */
+typedef struct effect_set_t{
+  int capacity;
+  int len;
+  unsigned long *hashes;
+  int **srcs;
+} effect_set_t;
+
+/* What every worker thread shares. Workers take one A at a time and try it
+ * with every B.
+ */
+typedef struct comm_work_t{
+  const comm_options_t *opts;
+  int size;
+  sequence_t *seqs;
+  int num_a;                  //The first num_a sequences are short enough for A
+  int num_b;
+  int num_c;
+  int *pieces;                //The piece each sticker is on
+  int num_pieces;
+  FILE *out;
+
+  pthread_mutex_t lock;
+  int next_a;
+  effect_set_t effects;
+  long candidates;
+  long found;
+  long duplicates;
+} comm_work_t;
+
+/******************************
+ * HELPER FUNCTION PROTOTYPES *
+ ******************************/
+
+/* Returns the piece each sticker of a cube of the given size is on, and sets
+ * *num_pieces. Corners and edge pieces are found through cubie.h, and every
+ * other sticker is a center piece of its own.
+ */
+int *piece_map(int side_len, int *num_pieces);
+
+/* Builds every sequence of up to max_len moves made from generators, shortest
+ * first, and sets up_to[l] to the number that are at most l moves long.
+ * Returns NULL if there would be more than MAX_SEQUENCES of them.
+ */
+sequence_t *build_sequences(alg_t *generators,
+                            int max_len,
+                            int *num,
+                            int *up_to);
+
+/* Frees the sequences returned by build_sequences.
+ */
+void free_sequences(sequence_t *seqs, int num);
+
+/* Returns the number of pieces that src moves, and sets *stickers to the
+ * number of stickers. seen must have room for every piece and is used to
+ * count them; *stamp is a value not in it yet.
+ */
+int count_pieces(comm_work_t *work,
+                 const int *src,
+                 int *seen,
+                 int *stamp,
+                 int *stickers);
+
+/* Adds src to the effects found unless it is already there, and if it is new
+ * writes it out as [C: [A, B]], where c is -1 for a plain commutator. Returns
+ * false if it was a duplicate.
+ */
+bool record(comm_work_t *work,
+            const int *src,
+            int a,
+            int b,
+            int c,
+            int pieces,
+            int stickers);
+
+/* Returns a hash of the given effect.
+ */
+unsigned long hash_effect(const int *src, int size);
+
+/* Adds src to set, which holds effects of the given size, unless it is
+ * already there. Returns false if it was.
+ */
+bool effect_insert(effect_set_t *set, const int *src, int size);
+
+/* The body of each worker thread.
+ */
+void *comm_worker(void *arg);
+
+/****************************
+ * FUNCTION IMPLEMENTATIONS *
+ ****************************/
+
+bool find_comms(const comm_options_t *opts, FILE *out, comm_stats_t *stats){
+  comm_stats_t local;
+  if(stats == NULL){
+    stats = &local;
+  }
+  memset(stats, 0, sizeof(comm_stats_t));
+  if(opts == NULL || out == NULL || opts->generators == NULL
+     || opts->generators->len < 1 || opts->generators->side_len < 2
+     || opts->max_a < 1 || opts->max_b < 1 || opts->max_c < 0
+     || opts->max_pieces < 1){
+    return false;
+  }
+
+  comm_work_t work;
+  memset(&work, 0, sizeof(comm_work_t));
+  int n = opts->generators->side_len;
+  int max_len = MAX(opts->max_a, MAX(opts->max_b, opts->max_c));
+  int *up_to = Calloc(max_len + 1, sizeof(int));
+  int num_seqs;
+  work.seqs = build_sequences(opts->generators, max_len, &num_seqs, up_to);
+  if(work.seqs == NULL){
+    fprintf(stderr, "More than %d sequences to try, use shorter ones or"
+            " fewer moves.\n", MAX_SEQUENCES);
+    free(up_to);
+    return false;
+  }
+
+  work.opts = opts;
+  work.size = NUM_FACES * n * n;
+  work.num_a = up_to[opts->max_a];
+  work.num_b = up_to[opts->max_b];
+  work.num_c = up_to[opts->max_c];
+  work.pieces = piece_map(n, &work.num_pieces);
+  work.out = out;
+  work.effects.capacity = 1024;
+  work.effects.hashes = Calloc(work.effects.capacity, sizeof(unsigned long));
+  work.effects.srcs = Calloc(work.effects.capacity, sizeof(int *));
+  pthread_mutex_init(&work.lock, NULL);
+  free(up_to);
+
+  //There is no point in having more threads than choices of A
+  int threads = MAX(1, MIN(opts->threads, work.num_a));
+  pthread_t *workers = Calloc(threads, sizeof(pthread_t));
+  double start = get_time();
+
+  for(int i = 0; i < threads; i++){
+    if(pthread_create(&workers[i], NULL, comm_worker, &work) != 0){
+      quit("Error: Could not start a thread!\n");
+    }
+  }
+  for(int i = 0; i < threads; i++){
+    pthread_join(workers[i], NULL);
+  }
+
+  stats->seconds = get_time() - start;
+  stats->threads = threads;
+  stats->sequences = num_seqs;
+  stats->candidates = work.candidates;
+  stats->found = work.found;
+  stats->duplicates = work.duplicates;
+
+  for(int i = 0; i < work.effects.capacity; i++){
+    free(work.effects.srcs[i]);
+  }
+  free(work.effects.srcs);
+  free(work.effects.hashes);
+  pthread_mutex_destroy(&work.lock);
+  free_sequences(work.seqs, num_seqs);
+  free(work.pieces);
+  free(workers);
+
+  return true;
+}
+
+/********************
+ * HELPER FUNCTIONS *
+ ********************/
+
+int *piece_map(int side_len, int *num_pieces){
+  int face_len = side_len * side_len;
+  int *ret = Calloc(NUM_FACES * face_len, sizeof(int));
+  for(int i = 0; i < NUM_FACES * face_len; i++){
+    ret[i] = -1;
+  }
+
+  int next = 0;
+  for(int corner = 0; corner < NUM_CORNERS; corner++){
+    for(int i = 0; i < 3; i++){
+      ret[corner_facelet(side_len, corner, i)] = next;
+    }
+    next++;
+  }
+  for(int edge = 0; edge < NUM_EDGES; edge++){
+    for(int k = 1; k < side_len - 1; k++){
+      ret[edge_facelet(side_len, edge, 0, k)] = next;
+      ret[edge_facelet(side_len, edge, 1, k)] = next;
+      next++;
+    }
+  }
+
+  //Whatever is left is a center
+  for(int i = 0; i < NUM_FACES * face_len; i++){
+    if(ret[i] < 0){
+      ret[i] = next;
+      next++;
+    }
+  }
+
+  *num_pieces = next;
+  return ret;
+}
+
+sequence_t *build_sequences(alg_t *generators,
+                            int max_len,
+                            int *num,
+                            int *up_to){
+  int n = generators->side_len;
+  int size = NUM_FACES * n * n;
+
+  //Every slice turned by the generators, once each
+  bool used[NUM_FACES][n];
+  memset(used, 0, sizeof(used));
+  int num_moves = 0;
+  move_t moves[NUM_FACES * n * 3];
+  for(int i = 0; i < generators->len; i++){
+    move_t g = generators->moves[i];
+    if(g.face < 0 || g.face >= NUM_FACES || g.depth < 0 || g.depth >= n
+       || used[g.face][g.depth]){
+      continue;
+    }
+
+    used[g.face][g.depth] = true;
+    for(int turns = 1; turns <= 3; turns++){
+      move_t m = {g.face, g.depth, turns};
+      moves[num_moves] = m;
+      num_moves++;
+    }
+  }
+
+  //Each sequence can be followed by any move on a different slice
+  long total = 0;
+  long level = num_moves;
+  for(int l = 1; l <= max_len; l++){
+    total += level;
+    if(total > MAX_SEQUENCES){
+      return NULL;
+    }
+    level *= num_moves - 3;
+  }
+
+  sequence_t *ret = Calloc(MAX(total, 1), sizeof(sequence_t));
+  perm_t **perms = Calloc(num_moves, sizeof(perm_t *));
+  perm_t **inverses = Calloc(num_moves, sizeof(perm_t *));
+  for(int i = 0; i < num_moves; i++){
+    alg_t *a = new_alg(n);
+    alg_append(a, moves[i]);
+    perms[i] = compile_alg(a);
+    inverses[i] = invert_perm(perms[i]);
+    ret[i].alg = a;
+    ret[i].src = Calloc(size, sizeof(int));
+    ret[i].inv = Calloc(size, sizeof(int));
+    memcpy(ret[i].src, perms[i]->src, size * sizeof(int));
+    memcpy(ret[i].inv, inverses[i]->src, size * sizeof(int));
+  }
+
+  int count = num_moves;
+  int level_start = 0;
+  up_to[0] = 0;
+  up_to[1] = count;
+  for(int l = 2; l <= max_len; l++){
+    int level_end = count;
+    for(int s = level_start; s < level_end; s++){
+      move_t last = ret[s].alg->moves[ret[s].alg->len - 1];
+      for(int i = 0; i < num_moves; i++){
+        if(moves[i].face == last.face && moves[i].depth == last.depth){
+          continue;
+        }
+
+        sequence_t *next = &ret[count];
+        next->alg = copy_alg(ret[s].alg);
+        alg_append(next->alg, moves[i]);
+        next->src = Calloc(size, sizeof(int));
+        next->inv = Calloc(size, sizeof(int));
+        for(int p = 0; p < size; p++){
+          next->src[p] = ret[s].src[perms[i]->src[p]];
+          next->inv[p] = inverses[i]->src[ret[s].inv[p]];
+        }
+        count++;
+      }
+    }
+    level_start = level_end;
+    up_to[l] = count;
+  }
+
+  for(int i = 0; i < num_moves; i++){
+    free_perm(perms[i]);
+    free_perm(inverses[i]);
+  }
+  free(perms);
+  free(inverses);
+
+  *num = count;
+  return ret;
+}
+
+void free_sequences(sequence_t *seqs, int num){
+  for(int i = 0; i < num; i++){
+    free_alg(seqs[i].alg);
+    free(seqs[i].src);
+    free(seqs[i].inv);
+  }
+  free(seqs);
+}
+
+int count_pieces(comm_work_t *work,
+                 const int *src,
+                 int *seen,
+                 int *stamp,
+                 int *stickers){
+  int pieces = 0;
+  *stickers = 0;
+  *stamp += 1;
+
+  for(int p = 0; p < work->size; p++){
+    if(src[p] == p){
+      continue;
+    }
+
+    *stickers += 1;
+    int piece = work->pieces[p];
+    if(seen[piece] != *stamp){
+      seen[piece] = *stamp;
+      pieces++;
+    }
+  }
+
+  return pieces;
+}
+
+bool record(comm_work_t *work,
+            const int *src,
+            int a,
+            int b,
+            int c,
+            int pieces,
+            int stickers){
+  //Only the set of effects needs the lock, not working out what to print
+  pthread_mutex_lock(&work->lock);
+  bool inserted = effect_insert(&work->effects, src, work->size);
+  if(inserted){
+    work->found++;
+  }
+  else{
+    work->duplicates++;
+  }
+  pthread_mutex_unlock(&work->lock);
+  if(!inserted){
+    return false;
+  }
+
+  //The moves written out in full, with anything that cancels taken out
+  sequence_t *seqs = work->seqs;
+  alg_t *moves = new_alg(seqs[a].alg->side_len);
+  alg_t *parts[6] = {NULL};
+  parts[1] = seqs[a].alg;
+  parts[2] = seqs[b].alg;
+  parts[3] = invert_alg(seqs[a].alg);
+  parts[4] = invert_alg(seqs[b].alg);
+  if(c >= 0){
+    parts[0] = seqs[c].alg;
+    parts[5] = invert_alg(seqs[c].alg);
+  }
+  for(int i = 0; i < 6; i++){
+    for(int j = 0; parts[i] != NULL && j < parts[i]->len; j++){
+      alg_append(moves, parts[i]->moves[j]);
+    }
+  }
+  simplify_alg(moves);
+
+  char *str = alg_to_string(moves);
+  char *str_a = alg_to_string(seqs[a].alg);
+  char *str_b = alg_to_string(seqs[b].alg);
+  char notation[MAX_NOTATION_LEN];
+  if(c >= 0){
+    char *str_c = alg_to_string(seqs[c].alg);
+    snprintf(notation, MAX_NOTATION_LEN, "[%s: [%s, %s]]",
+             str_c, str_a, str_b);
+    free(str_c);
+  }
+  else{
+    snprintf(notation, MAX_NOTATION_LEN, "[%s, %s]", str_a, str_b);
+  }
+
+  pthread_mutex_lock(&work->lock);
+  fprintf(work->out, "%s  # %s: %d pieces, %d stickers\n",
+          str, notation, pieces, stickers);
+  fflush(work->out);
+  pthread_mutex_unlock(&work->lock);
+
+  free(str);
+  free(str_a);
+  free(str_b);
+  free_alg(parts[3]);
+  free_alg(parts[4]);
+  free_alg(parts[5]);
+  free_alg(moves);
+  return true;
+}
+
+unsigned long hash_effect(const int *src, int size){
+  //FNV-1a
+  unsigned long hash = 2166136261UL;
+  for(int i = 0; i < size; i++){
+    hash ^= (unsigned long) src[i];
+    hash *= 16777619UL;
+  }
+
+  return hash;
+}
+
+bool effect_insert(effect_set_t *set, const int *src, int size){
+  //Grow once half full, so probes stay short
+  if((set->len + 1) * 2 > set->capacity){
+    effect_set_t bigger;
+    bigger.capacity = set->capacity * 2;
+    bigger.len = set->len;
+    bigger.hashes = Calloc(bigger.capacity, sizeof(unsigned long));
+    bigger.srcs = Calloc(bigger.capacity, sizeof(int *));
+
+    for(int i = 0; i < set->capacity; i++){
+      if(set->srcs[i] == NULL){
+        continue;
+      }
+      int slot = set->hashes[i] % bigger.capacity;
+      while(bigger.srcs[slot] != NULL){
+        slot = (slot + 1) % bigger.capacity;
+      }
+      bigger.hashes[slot] = set->hashes[i];
+      bigger.srcs[slot] = set->srcs[i];
+    }
+
+    free(set->hashes);
+    free(set->srcs);
+    *set = bigger;
+  }
+
+  unsigned long hash = hash_effect(src, size);
+  int slot = hash % set->capacity;
+  while(set->srcs[slot] != NULL){
+    if(set->hashes[slot] == hash
+       && memcmp(set->srcs[slot], src, size * sizeof(int)) == 0){
+      return false;
+    }
+    slot = (slot + 1) % set->capacity;
+  }
+
+  set->hashes[slot] = hash;
+  set->srcs[slot] = Calloc(size, sizeof(int));
+  memcpy(set->srcs[slot], src, size * sizeof(int));
+  set->len++;
+  return true;
+}
+
+void *comm_worker(void *arg){
+  comm_work_t *work = arg;
+  sequence_t *seqs = work->seqs;
+  int size = work->size;
+  int *x = Calloc(size, sizeof(int));
+  int *y = Calloc(size, sizeof(int));
+  int *seen = Calloc(work->num_pieces, sizeof(int));
+  int stamp = 0;
+  long candidates = 0;
+
+  while(true){
+    pthread_mutex_lock(&work->lock);
+    int a = work->next_a;
+    work->next_a++;
+    pthread_mutex_unlock(&work->lock);
+
+    if(a >= work->num_a){
+      break;
+    }
+
+    const int *a_src = seqs[a].src;
+    const int *a_inv = seqs[a].inv;
+    for(int b = 0; b < work->num_b; b++){
+      //A, then B, then A', then B'
+      const int *b_src = seqs[b].src;
+      const int *b_inv = seqs[b].inv;
+      for(int p = 0; p < size; p++){
+        x[p] = a_src[b_src[a_inv[b_inv[p]]]];
+      }
+      candidates++;
+
+      int stickers;
+      int pieces = count_pieces(work, x, seen, &stamp, &stickers);
+      if(pieces == 0 || pieces > work->opts->max_pieces
+         || !record(work, x, a, b, -1, pieces, stickers)){
+        continue;
+      }
+
+      //A conjugate moves as many pieces as what it conjugates
+      for(int c = 0; c < work->num_c; c++){
+        const int *c_src = seqs[c].src;
+        const int *c_inv = seqs[c].inv;
+        for(int p = 0; p < size; p++){
+          y[p] = c_src[x[c_inv[p]]];
+        }
+        candidates++;
+        record(work, y, a, b, c, pieces, stickers);
+      }
+    }
+  }
+
+  pthread_mutex_lock(&work->lock);
+  work->candidates += candidates;
+  pthread_mutex_unlock(&work->lock);
+
+  free(x);
+  free(y);
+  free(seen);
+  return NULL;
+}
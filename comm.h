@@ -0,0 +1,47 @@
+#ifndef COMM_H
+#define COMM_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "alg.h"
+
+/* What find_comms should search. Sequences are built from the moves in
+ * generators, each also taken as a half turn and turned the other way, and
+ * never turn the same slice twice in a row. A is at most max_a moves long, B
+ * at most max_b and C at most max_c, where a max_c of 0 means no conjugates
+ * are tried.
+ */
+typedef struct comm_options_t{
+  alg_t *generators;
+  int max_a;
+  int max_b;
+  int max_c;
+  int max_pieces;
+  int threads;
+} comm_options_t;
+
+/* What a call to find_comms did. candidates counts every commutator and
+ * conjugate looked at, and duplicates those skipped for having the same
+ * effect as one found before.
+ */
+typedef struct comm_stats_t{
+  long candidates;
+  long found;
+  long duplicates;
+  int sequences;
+  int threads;
+  double seconds;
+} comm_stats_t;
+
+/* Tries every commutator [A, B] of the sequences described by opts and keeps
+ * those that move at most max_pieces pieces, counting a piece that only
+ * twists or flips in place. Every one kept is also conjugated by each C, as
+ * [C: [A, B]]. Results whose effect on the cube is the same as one already
+ * found are skipped. Each result is written to out as soon as it is found,
+ * as its moves followed by a comment with its notation, so that the output
+ * can be read back by verify. Returns false if the options are invalid.
+ * stats may be NULL.
+ */
+bool find_comms(const comm_options_t *opts, FILE *out, comm_stats_t *stats);
+
+#endif
@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "cubie.h"
+
+#define NUM_FACES 6
+#define NUM_SIDES 4
+
+/* The faces next to each face, going clockwise from its top side.
+ */
+static const int NEIGHBORS[NUM_FACES][NUM_SIDES] = {
+  {4, 3, 2, 1}, {0, 2, 5, 4}, {0, 3, 5, 1},
+  {0, 4, 5, 2}, {0, 1, 5, 3}, {2, 3, 4, 1}
+};
+
+/* Every corner as its U or D face followed by the other two clockwise.
+ */
+static const int CORNERS[NUM_CORNERS][3] = {
+  {2, 0, 3}, {2, 3, 5}, {2, 5, 1}, {2, 1, 0},
+  {4, 0, 1}, {4, 1, 5}, {4, 5, 3}, {4, 3, 0}
+};
+
+/* Every edge as the face its orientation is measured by and then the other.
+ * Those are U or D for the first eight, and F or B for the middle layer.
+ */
+static const int EDGES[NUM_EDGES][2] = {
+  {2, 0}, {2, 3}, {2, 5}, {2, 1}, {4, 0}, {4, 1}, {4, 5}, {4, 3},
+  {5, 3}, {5, 1}, {0, 1}, {0, 3}
+};
+
+/******************************
+ * HELPER FUNCTION PROTOTYPES *
+ ******************************/
+
+/* Returns the number of swaps in the given permutation, modulo 2.
+ */
+int parity(const int *perm, int len);
+
+/****************************
+ * FUNCTION IMPLEMENTATIONS *
+ ****************************/
+
+int face_neighbor(int face, int side){
+  return NEIGHBORS[face][side];
+}
+
+int side_towards(int face, int other){
+  for(int side = 0; side < NUM_SIDES; side++){
+    if(NEIGHBORS[face][side] == other){
+      return side;
+    }
+  }
+
+  return -1;
+}
+
+void corner_faces(int corner, int faces[3]){
+  memcpy(faces, CORNERS[corner], 3 * sizeof(int));
+}
+
+void edge_faces(int edge, int faces[2]){
+  memcpy(faces, EDGES[edge], 2 * sizeof(int));
+}
+
+int corner_facelet(int side_len, int corner, int i){
+  int face = CORNERS[corner][i];
+  int a = side_towards(face, CORNERS[corner][(i + 1) % 3]);
+  int b = side_towards(face, CORNERS[corner][(i + 2) % 3]);
+
+  //The last sticker of a strip is in the corner it shares with the next side
+  int side = (a + 1) % NUM_SIDES == b ? a : b;
+  return face * side_len * side_len
+    + strip_coord(side, 0, side_len - 1, side_len);
+}
+
+int edge_facelet(int side_len, int edge, int i, int k){
+  int face = EDGES[edge][i];
+  int side = side_towards(face, EDGES[edge][1 - i]);
+
+  //The two faces run along their shared edge in opposite directions
+  int j = i == 0 ? k : side_len - 1 - k;
+  return face * side_len * side_len + strip_coord(side, 0, j, side_len);
+}
+
+void solved_cubie(cubie_t *c){
+  for(int i = 0; i < NUM_CORNERS; i++){
+    c->cp[i] = i;
+    c->co[i] = 0;
+  }
+  for(int i = 0; i < NUM_EDGES; i++){
+    c->ep[i] = i;
+    c->eo[i] = 0;
+  }
+}
+
+void cubie_multiply(const cubie_t *a, const cubie_t *b, cubie_t *out){
+  for(int i = 0; i < NUM_CORNERS; i++){
+    out->cp[i] = a->cp[b->cp[i]];
+    out->co[i] = (a->co[b->cp[i]] + b->co[i]) % 3;
+  }
+  for(int i = 0; i < NUM_EDGES; i++){
+    out->ep[i] = a->ep[b->ep[i]];
+    out->eo[i] = (a->eo[b->ep[i]] + b->eo[i]) % 2;
+  }
+}
+
+bool cubie_from_stickers(const color *stickers, cubie_t *c){
+  //The center of each face says which color belongs there
+  int face_of[NUM_FACES];
+  for(int f = 0; f < NUM_FACES; f++){
+    face_of[f] = -1;
+  }
+  for(int f = 0; f < NUM_FACES; f++){
+    color center = stickers[f * 9 + 4];
+    if(center < 0 || center >= NUM_FACES || face_of[(int) center] >= 0){
+      return false;
+    }
+    face_of[(int) center] = f;
+  }
+
+  bool corner_seen[NUM_CORNERS] = {false};
+  int twist = 0;
+  for(int i = 0; i < NUM_CORNERS; i++){
+    int faces[3];
+    for(int j = 0; j < 3; j++){
+      faces[j] = face_of[(int) stickers[corner_facelet(3, i, j)]];
+    }
+
+    //Find the U or D sticker, then which corner reads that way from it
+    c->cp[i] = -1;
+    for(int o = 0; o < 3 && c->cp[i] < 0; o++){
+      for(int k = 0; k < NUM_CORNERS; k++){
+        if(faces[o] == CORNERS[k][0]
+           && faces[(o + 1) % 3] == CORNERS[k][1]
+           && faces[(o + 2) % 3] == CORNERS[k][2]){
+          c->cp[i] = k;
+          c->co[i] = o;
+        }
+      }
+    }
+    if(c->cp[i] < 0 || corner_seen[c->cp[i]]){
+      return false;
+    }
+    corner_seen[c->cp[i]] = true;
+    twist += c->co[i];
+  }
+
+  bool edge_seen[NUM_EDGES] = {false};
+  int flip = 0;
+  for(int i = 0; i < NUM_EDGES; i++){
+    int a = face_of[(int) stickers[edge_facelet(3, i, 0, 1)]];
+    int b = face_of[(int) stickers[edge_facelet(3, i, 1, 1)]];
+
+    c->ep[i] = -1;
+    for(int k = 0; k < NUM_EDGES; k++){
+      if(a == EDGES[k][0] && b == EDGES[k][1]){
+        c->ep[i] = k;
+        c->eo[i] = 0;
+      }
+      else if(a == EDGES[k][1] && b == EDGES[k][0]){
+        c->ep[i] = k;
+        c->eo[i] = 1;
+      }
+    }
+    if(c->ep[i] < 0 || edge_seen[c->ep[i]]){
+      return false;
+    }
+    edge_seen[c->ep[i]] = true;
+    flip += c->eo[i];
+  }
+
+  //A twisted corner, flipped edge, or lone swap can't be undone by turning
+  return twist % 3 == 0 && flip % 2 == 0
+    && parity(c->cp, NUM_CORNERS) == parity(c->ep, NUM_EDGES);
+}
+
+/********************
+ * HELPER FUNCTIONS *
+ ********************/
+
+int parity(const int *perm, int len){
+  int ret = 0;
+  for(int i = 0; i < len; i++){
+    for(int j = i + 1; j < len; j++){
+      if(perm[j] < perm[i]){
+        ret++;
+      }
+    }
+  }
+
+  return ret % 2;
+}
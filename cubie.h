@@ -0,0 +1,71 @@
+#ifndef CUBIE_H
+#define CUBIE_H
+
+#include <stdbool.h>
+#include "state.h"
+
+#define NUM_CORNERS 8
+#define NUM_EDGES 12
+
+/* A 3x3 cube described by its pieces rather than its stickers. cp[i] is the
+ * corner sitting in corner position i and co[i] its twist, the facelet of
+ * the position (0 to 2) that the corner's U or D sticker is on. Edges are
+ * the same, with eo[i] being 1 if the edge is flipped. Edges 8 to 11 are the
+ * ones between U and D, so the other eight are the U and D layer edges.
+ */
+typedef struct cubie_t{
+  int cp[NUM_CORNERS];
+  int co[NUM_CORNERS];
+  int ep[NUM_EDGES];
+  int eo[NUM_EDGES];
+} cubie_t;
+
+/* Returns the face on the given side of face, with sides numbered clockwise
+ * from the top as in the rest of the simulator.
+ */
+int face_neighbor(int face, int side);
+
+/* Returns the side of face that touches other, or -1 if they are not next to
+ * each other.
+ */
+int side_towards(int face, int other);
+
+/* Stores the faces of the given corner in faces, starting with its U or D
+ * face and going clockwise around the corner.
+ */
+void corner_faces(int corner, int faces[3]);
+
+/* Stores the faces of the given edge in faces, starting with the face of the
+ * sticker its orientation is measured by.
+ */
+void edge_faces(int edge, int faces[2]);
+
+/* Returns the index of the ith facelet of the given corner among the stickers
+ * exported from a cube of the given size.
+ */
+int corner_facelet(int side_len, int corner, int i);
+
+/* Returns the index of the ith facelet of the given edge among the stickers
+ * exported from a cube of the given size. On bigger cubes an edge has
+ * side_len - 2 pieces; k picks one, from 1 to side_len - 2, so that both
+ * facelets of the same k are on the same piece.
+ */
+int edge_facelet(int side_len, int edge, int i, int k);
+
+/* Sets c to the solved cube.
+ */
+void solved_cubie(cubie_t *c);
+
+/* Stores the result of doing a and then b in out, which may not be either
+ * of them.
+ */
+void cubie_multiply(const cubie_t *a, const cubie_t *b, cubie_t *out);
+
+/* Reads the pieces of a 3x3 cube from its exported stickers. Colors are
+ * matched to faces by the centers, so a cube turned with slice moves still
+ * reads as solved once each face is one color. Returns false if the stickers
+ * do not make up a cube that can be solved.
+ */
+bool cubie_from_stickers(const color *stickers, cubie_t *c);
+
+#endif
@@ -0,0 +1,302 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include "goal.h"
+#include "helpers.h"
+
+#define NUM_FACES 6
+#define STICKERS_PER_WORD 8
+#define ANY_COLOR 0x3F
+#define LANES 0x0101010101010101ULL
+
+/* Stickers are packed one per byte, so a word holds eight of them. Keeping
+ * every table in words means a candidate is compared eight stickers at a
+ * time, straight from its exported bytes.
+ */
+struct goal_t{
+  int side_len;
+  int num_stickers;
+  int num_words;
+  int num_classes;      //Stickers accepting neither one color nor all
+  uint64_t *accept;     //The colors each sticker accepts, as a bit set
+  uint64_t *value;      //The color of each sticker accepting only one
+  uint64_t *care;       //0xFF for each sticker accepting only one color
+};
+
+/******************************
+ * HELPER FUNCTION PROTOTYPES *
+ ******************************/
+
+/* Loads the given word of exported stickers. The last word is padded with
+ * color 0, which the padding in every goal accepts.
+ */
+uint64_t load_stickers(const color *stickers, int word, int num_stickers);
+
+/* Returns LANES with the low bit of each byte set if the color in that byte
+ * of x is in the set of colors in the same byte of accept.
+ */
+uint64_t accepted_lanes(uint64_t accept, uint64_t x);
+
+/* Returns the number of colors in the set.
+ */
+int count_colors(int colors);
+
+/****************************
+ * FUNCTION IMPLEMENTATIONS *
+ ****************************/
+
+goal_t *new_goal(int side_len){
+  goal_t *ret = Calloc(1, sizeof(goal_t));
+  ret->side_len = side_len;
+  ret->num_stickers = NUM_FACES * side_len * side_len;
+  ret->num_words = (ret->num_stickers + STICKERS_PER_WORD - 1)
+    / STICKERS_PER_WORD;
+  ret->accept = Calloc(ret->num_words, sizeof(uint64_t));
+  ret->value = Calloc(ret->num_words, sizeof(uint64_t));
+  ret->care = Calloc(ret->num_words, sizeof(uint64_t));
+
+  //Every sticker, including the padding, starts out accepting anything
+  memset(ret->accept, ANY_COLOR, ret->num_words * sizeof(uint64_t));
+
+  return ret;
+}
+
+void free_goal(goal_t *g){
+  if(g == NULL){
+    return;
+  }
+
+  free(g->accept);
+  free(g->value);
+  free(g->care);
+  free(g);
+}
+
+goal_t *goal_from_stickers(int side_len, const color *stickers){
+  goal_t *ret = new_goal(side_len);
+  for(int i = 0; i < ret->num_stickers; i++){
+    goal_set(ret, i, 1 << stickers[i]);
+  }
+
+  return ret;
+}
+
+void goal_set(goal_t *g, int index, int colors){
+  if(g == NULL || index < 0 || index >= g->num_stickers){
+    return;
+  }
+  colors &= ANY_COLOR;
+
+  //Words are written a byte at a time so that lanes match the stickers
+  unsigned char *accept = (unsigned char *) g->accept;
+  unsigned char *value = (unsigned char *) g->value;
+  unsigned char *care = (unsigned char *) g->care;
+
+  //Stickers accepting no colors at all need the general test too
+  int old_count = count_colors(accept[index]);
+  if(old_count != 1 && old_count < NUM_FACES){
+    g->num_classes--;
+  }
+
+  int count = count_colors(colors);
+  if(count != 1 && count < NUM_FACES){
+    g->num_classes++;
+  }
+
+  accept[index] = colors;
+  care[index] = count == 1 ? 0xFF : 0;
+  value[index] = 0;
+  for(int c = 0; count == 1 && c < NUM_FACES; c++){
+    if(colors == 1 << c){
+      value[index] = c;
+    }
+  }
+}
+
+goal_t *parse_goal(int side_len, const char *text){
+  if(text == NULL){
+    return NULL;
+  }
+
+  goal_t *ret = new_goal(side_len);
+  int classes['z' - 'a' + 1];
+  memset(classes, 0, sizeof(classes));
+  int index = 0;
+  bool ok = true;
+
+  const char *line = text;
+  while(ok && *line != '\0'){
+    int len = strcspn(line, "\n");
+    int content_len = strcspn(line, "#\n");
+
+    //A class definition, like "a=BG"
+    const char *equals = memchr(line, '=', content_len);
+    if(equals != NULL){
+      int name = -1;
+      for(const char *c = line; c < equals; c++){
+        if(islower(*c) && name < 0){
+          name = *c - 'a';
+        }
+        else if(!isspace(*c)){
+          ok = false;
+        }
+      }
+      ok = ok && name >= 0;
+
+      for(const char *c = equals + 1; ok && c < line + content_len; c++){
+        if(isspace(*c)){
+          continue;
+        }
+        int color = color_from_letter(*c);
+        if(color < 0){
+          ok = false;
+        }
+        else{
+          classes[name] |= 1 << color;
+        }
+      }
+    }
+    //Otherwise, a row of stickers
+    else{
+      for(const char *c = line; ok && c < line + content_len; c++){
+        int colors = -1;
+        if(isspace(*c)){
+          continue;
+        }
+        else if(*c == '.'){
+          colors = ANY_COLOR;
+        }
+        else if(isupper(*c) && color_from_letter(*c) >= 0){
+          colors = 1 << color_from_letter(*c);
+        }
+        else if(islower(*c) && classes[*c - 'a'] != 0){
+          colors = classes[*c - 'a'];
+        }
+
+        if(colors < 0 || index >= ret->num_stickers){
+          ok = false;
+        }
+        else{
+          goal_set(ret, index, colors);
+          index++;
+        }
+      }
+    }
+
+    line += len;
+    if(*line == '\n'){
+      line++;
+    }
+  }
+
+  if(!ok || index != ret->num_stickers){
+    free_goal(ret);
+    return NULL;
+  }
+
+  return ret;
+}
+
+goal_t *read_goal(const char *path, int side_len){
+  FILE *f = fopen(path, "r");
+  if(f == NULL){
+    fprintf(stderr, "Could not open %s\n", path);
+    return NULL;
+  }
+
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  char *text = Calloc(size + 1, sizeof(char));
+  size = fread(text, 1, size, f);
+  text[size] = '\0';
+  fclose(f);
+
+  goal_t *ret = parse_goal(side_len, text);
+  if(ret == NULL){
+    fprintf(stderr, "Invalid goal in %s\n", path);
+  }
+
+  free(text);
+  return ret;
+}
+
+bool goal_matches(goal_t *g, const color *stickers){
+  //With no classes, every sticker is either an exact match or ignored
+  if(g->num_classes == 0){
+    for(int w = 0; w < g->num_words; w++){
+      uint64_t x = load_stickers(stickers, w, g->num_stickers);
+      if(((x ^ g->value[w]) & g->care[w]) != 0){
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  for(int w = 0; w < g->num_words; w++){
+    uint64_t x = load_stickers(stickers, w, g->num_stickers);
+    if(accepted_lanes(g->accept[w], x) != LANES){
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool goal_matches_state(goal_t *g, state_t *s){
+  if(g == NULL || s == NULL || state_side_len(s) != g->side_len){
+    return false;
+  }
+
+  color *stickers = Calloc(g->num_stickers, sizeof(color));
+  state_export(s, stickers);
+  bool ret = goal_matches(g, stickers);
+  free(stickers);
+
+  return ret;
+}
+
+/********************
+ * HELPER FUNCTIONS *
+ ********************/
+
+uint64_t load_stickers(const color *stickers, int word, int num_stickers){
+  uint64_t ret = 0;
+  int start = word * STICKERS_PER_WORD;
+  memcpy(&ret, stickers + start, MIN(STICKERS_PER_WORD, num_stickers - start));
+
+  return ret;
+}
+
+uint64_t accepted_lanes(uint64_t accept, uint64_t x){
+  //Spread each bit of every color across its whole byte
+  uint64_t bit0 = (x & LANES) * 0xFF;
+  uint64_t bit1 = ((x >> 1) & LANES) * 0xFF;
+  uint64_t bit2 = ((x >> 2) & LANES) * 0xFF;
+
+  /* Each byte of accept is a set of six colors. Every step halves the part
+   * of the set still in question by looking at one bit of the color, until
+   * the low bit of the byte says whether that exact color was in the set.
+   * The masks stop bits shifting in from the byte above.
+   */
+  accept = (accept & ~bit2) | ((accept >> 4) & 0x0F0F0F0F0F0F0F0FULL & bit2);
+  accept = (accept & ~bit1) | ((accept >> 2) & 0x3F3F3F3F3F3F3F3FULL & bit1);
+  accept = (accept & ~bit0) | ((accept >> 1) & 0x7F7F7F7F7F7F7F7FULL & bit0);
+
+  return accept & LANES;
+}
+
+int count_colors(int colors){
+  int ret = 0;
+  for(int c = 0; c < NUM_FACES; c++){
+    if(colors & (1 << c)){
+      ret++;
+    }
+  }
+
+  return ret;
+}
@@ -0,0 +1,53 @@
+#ifndef GOAL_H
+#define GOAL_H
+
+#include <stdbool.h>
+#include "state.h"
+
+/* A target for a search or verification that only cares about some of the
+ * stickers. Each sticker position accepts a set of colors: exactly one, a
+ * class of interchangeable colors, or any color at all. Goals are compiled
+ * into packed words, eight stickers to a word, so testing a candidate is a
+ * few word-wide operations per word rather than a loop over the stickers.
+ */
+typedef struct goal_t goal_t;
+
+/* Returns a goal for cubes of the given size that accepts any state.
+ */
+goal_t *new_goal(int side_len);
+
+/* Frees a given goal.
+ */
+void free_goal(goal_t *g);
+
+/* Returns a goal that only accepts exactly the given exported stickers.
+ */
+goal_t *goal_from_stickers(int side_len, const color *stickers);
+
+/* Sets which colors the sticker at index, numbered the way state_export lays
+ * them out, accepts. Bit c of colors is set if color c is accepted, so 0x3F
+ * means the sticker is not cared about.
+ */
+void goal_set(goal_t *g, int index, int colors);
+
+/* Parses a goal written as one character per sticker, in the order
+ * state_export uses, with whitespace ignored. An uppercase color letter
+ * accepts just that color, '.' accepts any color, and a lowercase letter
+ * names a class of colors defined on an earlier line like "a=BG". Anything
+ * after a '#' on a line is a comment. Returns NULL if the text is invalid.
+ */
+goal_t *parse_goal(int side_len, const char *text);
+
+/* Reads a goal in the format parse_goal takes from a file.
+ */
+goal_t *read_goal(const char *path, int side_len);
+
+/* Returns true if the exported stickers satisfy the goal.
+ */
+bool goal_matches(goal_t *g, const color *stickers);
+
+/* Returns true if the given state satisfies the goal.
+ */
+bool goal_matches_state(goal_t *g, state_t *s);
+
+#endif
@@ -1,3 +1,5 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <ctype.h>
 #include <curses.h>
 #include <math.h>
@@ -30,6 +32,17 @@ int get_coord(int x, int y, int width){
   return y * width + x;
 }
 
+int num_cores(){
+  long ret = sysconf(_SC_NPROCESSORS_ONLN);
+  return ret < 1 ? 1 : ret;
+}
+
+double get_time(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 void print_help(){
   clear();
   curs_set(0);
@@ -53,7 +66,9 @@ void print_help(){
   mvaddstr(10, 3,
 	   "To turn counter-clockwise, simply add an apostrophe to the end of");
   mvaddstr(11, 3,
-	   "the line, like this: \"2U'\"");
+	   "the line, like this: \"2U'\". A \"2\" after the face, like \"U2\",");
+  mvaddstr(12, 3,
+	   "makes a half turn.");
   mvaddstr(13, 3,
 	   "Pressing enter with no move specified will repeat the most");
   mvaddstr(14, 3,
@@ -62,6 +77,8 @@ void print_help(){
 	   "'q' quits the program. '?' brings you to this page.");
   mvaddstr(17, 3,
 	   "'n' creates a new cube and allows you to set the size.");
+  mvaddstr(18, 3,
+	   "'o' optimizes the moves made so far, cancelling and merging turns.");
   mvaddstr(21, 1, "Press any key to continue...");
   
   getch();
@@ -22,6 +22,15 @@ void quit(const char *error_msg);
  */
 int get_coord(int x, int y, int width);
 
+/* Returns the number of processors available to run threads on.
+ */
+int num_cores();
+
+/* Returns the current time in seconds from a monotonic clock, for measuring
+ * how long something took.
+ */
+double get_time();
+
 /* Prints a help message to the terminal for the user.
  */
 void print_help();
@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "alg.h"
+#include "helpers.h"
+#include "hint.h"
+#include "reduce.h"
+#include "twophase.h"
+
+struct hint_t{
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+
+  //Everything below is only touched while holding lock
+  state_t *pending;           //The newest state, until the worker takes it
+  long generation;            //Counts requests, so old searches can tell
+  bool quit;
+  bool changed;
+  char lines[HINT_LINES][HINT_LINE_LEN];
+};
+
+/* What the cancel callback needs to tell if its search is out of date.
+ */
+typedef struct hint_job_t{
+  hint_t *h;
+  long generation;
+} hint_job_t;
+
+/******************************
+ * HELPER FUNCTION PROTOTYPES *
+ ******************************/
+
+/* The body of the worker thread.
+ */
+void *hint_worker(void *arg);
+
+/* The cancel callback given to the solvers. True once a newer request has
+ * come in.
+ */
+bool hint_cancelled(void *arg);
+
+/* Replaces the hint text with the given lines, if generation is still the
+ * latest request. Any of the lines may be NULL to leave them blank.
+ */
+void set_hint(hint_t *h, long generation, const char *line0,
+              const char *line1, const char *line2);
+
+/****************************
+ * FUNCTION IMPLEMENTATIONS *
+ ****************************/
+
+hint_t *start_hints(){
+  hint_t *ret = Calloc(1, sizeof(hint_t));
+  pthread_mutex_init(&ret->lock, NULL);
+  pthread_cond_init(&ret->wake, NULL);
+
+  if(pthread_create(&ret->thread, NULL, hint_worker, ret) != 0){
+    quit("Error: Could not start a thread!\n");
+  }
+
+  return ret;
+}
+
+void stop_hints(hint_t *h){
+  if(h == NULL){
+    return;
+  }
+
+  //Bumping the generation cancels whatever is being searched
+  pthread_mutex_lock(&h->lock);
+  h->quit = true;
+  h->generation++;
+  pthread_cond_signal(&h->wake);
+  pthread_mutex_unlock(&h->lock);
+  pthread_join(h->thread, NULL);
+
+  free_state(h->pending);
+  pthread_cond_destroy(&h->wake);
+  pthread_mutex_destroy(&h->lock);
+  free(h);
+}
+
+void request_hint(hint_t *h, state_t *s){
+  state_t *snapshot = copy_state(s);
+
+  pthread_mutex_lock(&h->lock);
+  free_state(h->pending);
+  h->pending = snapshot;
+  h->generation++;
+  pthread_cond_signal(&h->wake);
+  pthread_mutex_unlock(&h->lock);
+}
+
+bool read_hint(hint_t *h, char lines[HINT_LINES][HINT_LINE_LEN]){
+  pthread_mutex_lock(&h->lock);
+  bool ret = h->changed;
+  memcpy(lines, h->lines, sizeof(h->lines));
+  h->changed = false;
+  pthread_mutex_unlock(&h->lock);
+
+  return ret;
+}
+
+/********************
+ * HELPER FUNCTIONS *
+ ********************/
+
+void *hint_worker(void *arg){
+  hint_t *h = arg;
+
+  while(true){
+    pthread_mutex_lock(&h->lock);
+    while(!h->quit && h->pending == NULL){
+      pthread_cond_wait(&h->wake, &h->lock);
+    }
+    if(h->quit){
+      pthread_mutex_unlock(&h->lock);
+      break;
+    }
+    state_t *s = h->pending;
+    h->pending = NULL;
+    hint_job_t job = {h, h->generation};
+    pthread_mutex_unlock(&h->lock);
+
+    set_hint(h, job.generation, "Thinking...", NULL, NULL);
+
+    solve_options_t opts = default_solve_options();
+    opts.cancel = hint_cancelled;
+    opts.cancel_arg = &job;
+    alg_t *solution = state_side_len(s) == 3
+      ? twophase_solve(s, &opts, NULL)
+      : reduce_solve(s, &opts, NULL);
+    free_state(s);
+
+    if(solution == NULL){
+      set_hint(h, job.generation, "No solution found", NULL, NULL);
+      continue;
+    }
+    if(solution->len == 0){
+      set_hint(h, job.generation, "Solved!", NULL, NULL);
+      free_alg(solution);
+      continue;
+    }
+
+    char next[HINT_LINE_LEN];
+    char length[HINT_LINE_LEN];
+    char str[MAX_MOVE_STR_LEN];
+    move_to_string(solution->moves[0], str);
+    snprintf(next, HINT_LINE_LEN, "Next: %s", str);
+    snprintf(length, HINT_LINE_LEN, "Solution: %d moves", solution->len);
+
+    //As much of the solution as fits on a line
+    char *all = alg_to_string(solution);
+    set_hint(h, job.generation, next, length, all);
+
+    free(all);
+    free_alg(solution);
+  }
+
+  return NULL;
+}
+
+bool hint_cancelled(void *arg){
+  hint_job_t *job = arg;
+
+  pthread_mutex_lock(&job->h->lock);
+  bool ret = job->h->generation != job->generation;
+  pthread_mutex_unlock(&job->h->lock);
+
+  return ret;
+}
+
+void set_hint(hint_t *h, long generation, const char *line0,
+              const char *line1, const char *line2){
+  const char *lines[HINT_LINES] = {line0, line1, line2};
+
+  pthread_mutex_lock(&h->lock);
+  if(generation == h->generation){
+    for(int i = 0; i < HINT_LINES; i++){
+      snprintf(h->lines[i], HINT_LINE_LEN, "%s",
+               lines[i] != NULL ? lines[i] : "");
+    }
+    h->changed = true;
+  }
+  pthread_mutex_unlock(&h->lock);
+}
@@ -0,0 +1,35 @@
+#ifndef HINT_H
+#define HINT_H
+
+#include <stdbool.h>
+#include "state.h"
+
+#define HINT_LINES 3
+#define HINT_LINE_LEN 32
+
+/* A solver running on its own thread, so that the interface never waits for
+ * it. Each request replaces the one before it, and any search still working
+ * on an old state is cancelled.
+ */
+typedef struct hint_t hint_t;
+
+/* Starts the worker thread and returns a handle to it.
+ */
+hint_t *start_hints();
+
+/* Cancels any search in progress, waits for the worker to finish and frees
+ * the handle.
+ */
+void stop_hints(hint_t *h);
+
+/* Asks for a solution to a copy of s, so s may change or be freed as soon as
+ * this returns.
+ */
+void request_hint(hint_t *h, state_t *s);
+
+/* Copies the text describing the latest result into lines. Returns true if
+ * it changed since the last call.
+ */
+bool read_hint(hint_t *h, char lines[HINT_LINES][HINT_LINE_LEN]);
+
+#endif
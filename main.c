@@ -5,12 +5,16 @@
 #include <ctype.h>
 #include <curses.h>
 #include <math.h>
+#include "alg.h"
+#include "batch.h"
 #include "helpers.h"
+#include "hint.h"
 #include "state.h"
 
 #define MAX_INPUT_LEN 16
 #define HISTORY_LEN 12
 #define HISTORY_ITEM_MAX_LEN MAX_INPUT_LEN
+#define HINT_POLL_MS 100
 
 /*********************
  * Private variables *
@@ -44,6 +48,20 @@ void log_history(char **history, char *item){
   memcpy(history[0], item, HISTORY_ITEM_MAX_LEN);
 }
 
+/* Returns a new history holding the last HISTORY_LEN moves of a.
+ */
+char **history_from_alg(alg_t *a){
+  char **history = Calloc(HISTORY_LEN, sizeof(char *));
+  char item[HISTORY_ITEM_MAX_LEN] = {0};
+
+  for(int i = MAX(0, a->len - HISTORY_LEN); i < a->len; i++){
+    move_to_string(a->moves[i], item);
+    log_history(history, item);
+  }
+
+  return history;
+}
+
 void print_history(char **history, int x_coord){
   if(history == NULL){
     return;
@@ -59,6 +77,16 @@ void print_history(char **history, int x_coord){
   }
 }
 
+/* Prints the solver's latest hint in a column starting at x_coord.
+ */
+void print_hint(char lines[HINT_LINES][HINT_LINE_LEN], int x_coord){
+  for(int i = 0; i < HINT_LINES; i++){
+    move(i, x_coord);
+    clrtoeol();
+    addstr(lines[i]);
+  }
+}
+
 void print_move_count(int count, int x_coord, int y_coord){
   if(count < 1){
     return;
@@ -144,6 +172,11 @@ bool confirm_restart(int input_line){
  * Main *
  ********/
 int main(int argc, char** argv){
+  //Any arguments mean we are running a batch command instead
+  if(argc > 1){
+    return batch_main(argc, argv);
+  }
+  
   //Setup
   WIN = initscr();
   timeout(-1);
@@ -155,10 +188,15 @@ int main(int argc, char** argv){
   
   bool help_menu_entered = false;
   bool restart = false;
+  bool optimized = false;
   int move_count = 0;
   char *input = Calloc(MAX_INPUT_LEN, sizeof(char));
   char **history = Calloc(HISTORY_LEN, sizeof(char *));
   state_t *s = new_state(side_len);
+  alg_t *session = new_alg(side_len);
+  hint_t *hints = start_hints();
+  char hint_lines[HINT_LINES][HINT_LINE_LEN] = {{0}};
+  request_hint(hints, s);
 
   
   //Main Loop
@@ -175,6 +213,9 @@ int main(int argc, char** argv){
     //Print history and move count
     print_history(history, side_len * 4 + 8);
     print_move_count(move_count, side_len * 4 + 8, input_line + 1);
+    int hint_x = side_len * 4 + 8 + HISTORY_ITEM_MAX_LEN + 4;
+    read_hint(hints, hint_lines);
+    print_hint(hint_lines, hint_x);
     
     //Setup for user input
     int c = 0;
@@ -190,7 +231,10 @@ int main(int argc, char** argv){
       index = strlen(input);
     }
     
-    //Read from keyboard until enter is pressed
+    /* Read from keyboard until enter is pressed. getch gives up every so
+     * often so that a new hint can be shown without waiting for a key.
+     */
+    timeout(HINT_POLL_MS);
     while((c != '\n') && (c != KEY_ENTER)){
       /* Rewriting the line every time keeps it looking neat in the event of a
        * double-wide charater, or when we return from the help screen.
@@ -201,6 +245,12 @@ int main(int argc, char** argv){
       
       c = getch();
 
+      //Nothing was typed, so only the hint may need redrawing
+      if(c == ERR){
+        if(read_hint(hints, hint_lines)){
+          print_hint(hint_lines, hint_x);
+        }
+      }
       //Handle backspace
       if(((c == KEY_BACKSPACE) || (c == 127) || (c == 7)) && index > 0){
 	index--;
@@ -220,6 +270,7 @@ int main(int argc, char** argv){
 	}
       }
     }
+    timeout(-1);
 
     //Check if they tried to quit
     if(strcmp(input, "q") == 0 || strcmp(input, "Q") == 0){
@@ -233,9 +284,20 @@ int main(int argc, char** argv){
         move_count = 0;
 	free_state(s);
 	s = new_state(side_len);
+	free_alg(session);
+	session = new_alg(side_len);
+        request_hint(hints, s);
       }
       restart = true;
     }
+    //Check if they want the moves so far optimized
+    if(strcmp(input, "o") == 0 || strcmp(input, "O") == 0){
+      simplify_alg(session);
+      free_history(history);
+      history = history_from_alg(session);
+      move_count = session->len;
+      optimized = true;
+    }
 
     //Check for help screen
     if(help_menu_entered){
@@ -245,6 +307,10 @@ int main(int argc, char** argv){
     else if(restart){
       restart = false;
     }
+    //Optimizing only rewrites the history, the cube stays the same
+    else if(optimized){
+      optimized = false;
+    }
     //Process the move
     else{
       //Just hitting enter repeats the previous command
@@ -255,9 +321,14 @@ int main(int argc, char** argv){
       state_t *temp = make_move(s, input);
       
       //Only add this input to history if it changed the cube
+      move_t m;
       if(!state_equal(temp, s)){
 	log_history(history, input);
         move_count++;
+	if(parse_move(input, &m)){
+	  alg_append(session, m);
+	}
+        request_hint(hints, temp);
       }
       
       print_state(temp);
@@ -266,10 +337,12 @@ int main(int argc, char** argv){
     }
   }
 
+  stop_hints(hints);
   if(s != NULL){
     free_state(s);
   }
   free_history(history);
+  free_alg(session);
   if(input != NULL){
     free(input);
   }
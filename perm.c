@@ -0,0 +1,152 @@
+#include <stdlib.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <string.h>
+#include "helpers.h"
+#include "perm.h"
+
+#define NUM_FACES 6
+
+/****************************
+ * FUNCTION IMPLEMENTATIONS *
+ ****************************/
+
+perm_t *new_perm(int side_len){
+  perm_t *ret = Calloc(1, sizeof(perm_t));
+  ret->side_len = side_len;
+  ret->size = NUM_FACES * side_len * side_len;
+  ret->src = Calloc(ret->size, sizeof(int));
+  for(int i = 0; i < ret->size; i++){
+    ret->src[i] = i;
+  }
+
+  return ret;
+}
+
+void free_perm(perm_t *p){
+  if(p == NULL){
+    return;
+  }
+
+  free(p->src);
+  free(p);
+}
+
+perm_t *compile_alg(alg_t *a){
+  if(a == NULL){
+    return NULL;
+  }
+
+  /* A state can only hold the six colors, so rather than labelling every
+   * sticker with its number we write the numbers out in base 6, one digit per
+   * state, and run the moves on each of those states. Reading the digits back
+   * at every position gives the number of the sticker that ended up there.
+   */
+  perm_t *ret = new_perm(a->side_len);
+  color *stickers = Calloc(ret->size, sizeof(color));
+  int place = 1;
+
+  for(int i = 0; i < ret->size; i++){
+    ret->src[i] = 0;
+  }
+  while(place < ret->size){
+    for(int i = 0; i < ret->size; i++){
+      stickers[i] = (i / place) % NUM_FACES;
+    }
+
+    state_t *s = state_import(a->side_len, stickers);
+    for(int i = 0; i < a->len; i++){
+      apply_move(s, a->moves[i]);
+    }
+    state_export(s, stickers);
+    free_state(s);
+
+    for(int i = 0; i < ret->size; i++){
+      ret->src[i] += stickers[i] * place;
+    }
+    place *= NUM_FACES;
+  }
+
+  free(stickers);
+
+  return ret;
+}
+
+perm_t *compose_perm(perm_t *a, perm_t *b){
+  perm_t *ret = new_perm(a->side_len);
+  for(int i = 0; i < ret->size; i++){
+    ret->src[i] = a->src[b->src[i]];
+  }
+
+  return ret;
+}
+
+perm_t *invert_perm(perm_t *p){
+  perm_t *ret = new_perm(p->side_len);
+  for(int i = 0; i < ret->size; i++){
+    ret->src[p->src[i]] = i;
+  }
+
+  return ret;
+}
+
+void apply_perm(perm_t *p, const color *in, color *out){
+  for(int i = 0; i < p->size; i++){
+    out[i] = in[p->src[i]];
+  }
+}
+
+bool perm_reaches(perm_t *p, const color *from, const color *to){
+  for(int i = 0; i < p->size; i++){
+    if(from[p->src[i]] != to[i]){
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int perm_support(perm_t *p){
+  int ret = 0;
+  for(int i = 0; i < p->size; i++){
+    if(p->src[i] != i){
+      ret++;
+    }
+  }
+
+  return ret;
+}
+
+bool perm_is_identity(perm_t *p){
+  return perm_support(p) == 0;
+}
+
+long perm_order(perm_t *p){
+  //The order is the least common multiple of the lengths of the cycles
+  bool *seen = Calloc(p->size, sizeof(bool));
+  long order = 1;
+
+  for(int i = 0; i < p->size && order > 0; i++){
+    if(seen[i]){
+      continue;
+    }
+
+    long len = 0;
+    for(int j = i; !seen[j]; j = p->src[j]){
+      seen[j] = true;
+      len++;
+    }
+
+    long a = order, b = len;
+    while(b != 0){
+      long r = a % b;
+      a = b;
+      b = r;
+    }
+    long step = len / a;
+    order = order > LONG_MAX / step ? -1 : order * step;
+  }
+
+  free(seen);
+  return order;
+}
@@ -0,0 +1,63 @@
+#ifndef PERM_H
+#define PERM_H
+
+#include <stdbool.h>
+#include "alg.h"
+#include "state.h"
+
+/* An algorithm compiled down to where every sticker ends up. Stickers are
+ * numbered the way state_export lays them out, and src[p] is the number of
+ * the sticker that the algorithm moves into position p. Applying a compiled
+ * algorithm costs one lookup per sticker, no matter how long it is.
+ */
+typedef struct perm_t{
+  int side_len;
+  int size;
+  int *src;
+} perm_t;
+
+/* Returns the permutation that leaves every sticker where it is.
+ */
+perm_t *new_perm(int side_len);
+
+/* Frees a given permutation.
+ */
+void free_perm(perm_t *p);
+
+/* Returns the permutation made by the moves of a.
+ */
+perm_t *compile_alg(alg_t *a);
+
+/* Returns the permutation made by doing a and then b. Both must be for the
+ * same size of cube.
+ */
+perm_t *compose_perm(perm_t *a, perm_t *b);
+
+/* Returns the permutation that undoes p.
+ */
+perm_t *invert_perm(perm_t *p);
+
+/* Writes the stickers that p makes out of in to out. in and out are arrays
+ * of exported stickers and must not overlap.
+ */
+void apply_perm(perm_t *p, const color *in, color *out);
+
+/* Returns true if doing p to the stickers in from gives exactly the stickers
+ * in to. Stops at the first sticker that differs.
+ */
+bool perm_reaches(perm_t *p, const color *from, const color *to);
+
+/* Returns the number of stickers p moves.
+ */
+int perm_support(perm_t *p);
+
+/* Returns true if p leaves every sticker where it is.
+ */
+bool perm_is_identity(perm_t *p);
+
+/* Returns how many times p has to be repeated to leave every sticker where it
+ * started, or -1 if that does not fit in a long.
+ */
+long perm_order(perm_t *p);
+
+#endif
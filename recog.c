@@ -0,0 +1,496 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include "alg.h"
+#include "helpers.h"
+#include "perm.h"
+#include "recog.h"
+#include "state.h"
+#include "verify.h"
+
+#define SIDE_LEN 3
+#define NUM_FACES 6
+#define NUM_SIDES 4
+#define FACE_LEN (SIDE_LEN * SIDE_LEN)
+#define NUM_STICKERS (NUM_FACES * FACE_LEN)
+#define UP 2
+#define CENTER 4
+#define SKIP_NAME "skip"
+#define MAX_NAME_LEN 32
+
+/* Keys hold three bits for each sticker: the eight around the center of U in
+ * the low bits and the twelve of the strips around U above them, each part in
+ * the order a turn of U moves them, so that turning U just rotates each part
+ * of the key.
+ */
+#define PATTERN_BITS 3
+#define RING_STICKERS 8
+#define RING_BITS (RING_STICKERS * PATTERN_BITS)
+#define RING_MASK ((1ULL << RING_BITS) - 1)
+#define STRIP_BITS ((LL_STICKERS - RING_STICKERS) * PATTERN_BITS)
+#define STRIP_MASK ((1ULL << STRIP_BITS) - 1)
+#define RING_TURN (2 * PATTERN_BITS)
+#define STRIP_TURN (SIDE_LEN * PATTERN_BITS)
+
+/* The strips around U as a face and the side of it touching U, in the order
+ * a turn of U moves them, the same as in state.c.
+ */
+static const int LL_SIDES[NUM_SIDES][2] = {
+  {0, 2}, {1, 1}, {5, 0}, {3, 3}
+};
+
+/* One case: every algorithm for it, and how each one's last layer is turned
+ * and recolored relative to key, the smallest form of the case.
+ */
+typedef struct case_t{
+  char *name;
+  uint64_t key;
+  int num_algs;
+  int capacity;
+  alg_t **algs;
+  int *turns;
+  int *shifts;
+} case_t;
+
+struct case_table_t{
+  bool orientation_only;
+  int positions[LL_STICKERS];   //Where each last layer sticker is exported
+  int f2l[NUM_STICKERS];        //Every other sticker
+  int num_f2l;
+  color relabel[NUM_SIDES][NUM_FACES];
+
+  int num_cases;
+  int capacity;
+  case_t *cases;
+  int *slots;                   //Hash table of case indices, -1 if empty
+  int num_slots;
+};
+
+/******************************
+ * HELPER FUNCTION PROTOTYPES *
+ ******************************/
+
+/* Returns an empty table with its sticker tables filled in.
+ */
+case_table_t *new_cases(bool orientation_only);
+
+/* Fills pattern with the last layer of the exported stickers of a 3x3, each
+ * sticker as the face whose center has its color, or for an orientation only
+ * table as whether it has the color of U. Returns false if the centers are
+ * not six different colors or the first two layers are not solved.
+ */
+bool read_pattern(const case_table_t *t,
+                  const color *stickers,
+                  color *pattern);
+
+/* Returns the key of a pattern after a turn of U.
+ */
+static inline uint64_t turn_key(uint64_t key);
+
+/* Returns the smallest key of pattern under every turn of U before it and
+ * every recoloring of the sides after it, setting *turns and *shift to the
+ * ones that gave it.
+ */
+uint64_t canonical_key(const case_table_t *t,
+                       const color *pattern,
+                       int *turns,
+                       int *shift);
+
+/* Returns the slot of the hash table that holds key, or the empty slot it
+ * would go in.
+ */
+int find_slot(const case_table_t *t, uint64_t key);
+
+/* Adds an algorithm to the case with the given key, making the case with the
+ * given name if it is new.
+ */
+void add_case_alg(case_table_t *t,
+                  uint64_t key,
+                  const char *name,
+                  alg_t *a,
+                  int turns,
+                  int shift);
+
+/* Adds the algorithm on a line of a library to its case. Returns false if
+ * the line is invalid or the algorithm disturbs the first two layers.
+ */
+bool add_line(case_table_t *t, const char *line, int line_num);
+
+/****************************
+ * FUNCTION IMPLEMENTATIONS *
+ ****************************/
+
+case_table_t *load_cases(const char *path, bool orientation_only){
+  FILE *f = fopen(path, "r");
+  if(f == NULL){
+    fprintf(stderr, "Could not open %s\n", path);
+    return NULL;
+  }
+
+  case_table_t *t = new_cases(orientation_only);
+  char *line = NULL;
+  size_t cap = 0;
+  int line_num = 0;
+  bool ok = true;
+
+  //The solved last layer goes first, so it is always a case
+  add_line(t, SKIP_NAME ":", 0);
+  while(ok && next_content_line(f, &line, &cap) != NULL){
+    line_num++;
+    ok = add_line(t, line, line_num);
+    if(!ok){
+      fprintf(stderr, "Invalid last layer algorithm in %s: %s\n", path,
+              line);
+    }
+  }
+
+  free(line);
+  fclose(f);
+  if(!ok){
+    free_cases(t);
+    return NULL;
+  }
+
+  return t;
+}
+
+void free_cases(case_table_t *t){
+  if(t == NULL){
+    return;
+  }
+
+  for(int i = 0; i < t->num_cases; i++){
+    case_t *c = &t->cases[i];
+    for(int j = 0; j < c->num_algs; j++){
+      free_alg(c->algs[j]);
+    }
+    free(c->algs);
+    free(c->turns);
+    free(c->shifts);
+    free(c->name);
+  }
+  free(t->cases);
+  free(t->slots);
+  free(t);
+}
+
+int num_cases(case_table_t *t){
+  return t == NULL ? 0 : t->num_cases;
+}
+
+bool recognize_ll(const case_table_t *t, state_t *s, ll_match_t *match){
+  if(t == NULL || state_side_len(s) != SIDE_LEN){
+    return false;
+  }
+
+  color stickers[NUM_STICKERS];
+  color pattern[LL_STICKERS];
+  state_export(s, stickers);
+  if(!read_pattern(t, stickers, pattern)){
+    return false;
+  }
+
+  int turns;
+  int shift;
+  uint64_t key = canonical_key(t, pattern, &turns, &shift);
+  int index = t->slots[find_slot(t, key)];
+  if(index < 0){
+    return false;
+  }
+
+  match->index = index;
+  match->name = t->cases[index].name;
+  match->num_algs = t->cases[index].num_algs;
+  match->turns = turns;
+  match->shift = shift;
+  return true;
+}
+
+alg_t *case_solution(const case_table_t *t,
+                     const ll_match_t *match,
+                     int which){
+  if(t == NULL || match == NULL || match->index < 0
+     || match->index >= t->num_cases){
+    return NULL;
+  }
+  case_t *c = &t->cases[match->index];
+  if(which < 0 || which >= c->num_algs){
+    return NULL;
+  }
+
+  /* Both the state and the algorithm's case are the same pattern once turned
+   * and recolored their own way, so the difference between the two ways is
+   * what lines the state up with the algorithm.
+   */
+  int pre = (match->turns - c->turns[which] + NUM_SIDES) % NUM_SIDES;
+  int post = (match->shift - c->shifts[which] + NUM_SIDES) % NUM_SIDES;
+
+  alg_t *ret = new_alg(SIDE_LEN);
+  if(pre != 0){
+    move_t m = {UP, 0, pre};
+    alg_append(ret, m);
+  }
+  alg_t *a = c->algs[which];
+  for(int i = 0; i < a->len; i++){
+    alg_append(ret, a->moves[i]);
+  }
+  if(post != 0 && !t->orientation_only){
+    move_t m = {UP, 0, post};
+    alg_append(ret, m);
+  }
+
+  return ret;
+}
+
+/********************
+ * HELPER FUNCTIONS *
+ ********************/
+
+case_table_t *new_cases(bool orientation_only){
+  case_table_t *t = Calloc(1, sizeof(case_table_t));
+  t->orientation_only = orientation_only;
+
+  /* Each sticker of the last layer is followed by the one a turn of U moves
+   * into its place: first a corner and an edge around the center of U, then
+   * the strip above the back face.
+   */
+  alg_t *u = new_alg(SIDE_LEN);
+  move_t m = {UP, 0, 1};
+  alg_append(u, m);
+  perm_t *p = compile_alg(u);
+  t->positions[0] = UP * FACE_LEN;
+  t->positions[1] = UP * FACE_LEN + 1;
+  for(int i = 2; i < RING_STICKERS; i++){
+    t->positions[i] = p->src[t->positions[i - 2]];
+  }
+  for(int j = 0; j < SIDE_LEN; j++){
+    t->positions[RING_STICKERS + j] = LL_SIDES[0][0] * FACE_LEN
+      + strip_coord(LL_SIDES[0][1], 0, j, SIDE_LEN);
+  }
+  for(int i = RING_STICKERS + SIDE_LEN; i < LL_STICKERS; i++){
+    t->positions[i] = p->src[t->positions[i - SIDE_LEN]];
+  }
+  free_perm(p);
+  free_alg(u);
+
+  bool in_ll[NUM_STICKERS] = {false};
+  for(int i = 0; i < LL_STICKERS; i++){
+    in_ll[t->positions[i]] = true;
+  }
+  for(int i = 0; i < NUM_STICKERS; i++){
+    if(!in_ll[i]){
+      t->f2l[t->num_f2l] = i;
+      t->num_f2l++;
+    }
+  }
+
+  //Recoloring the sides moves each one's color to the next side around U
+  for(int j = 0; j < NUM_SIDES; j++){
+    for(int c = 0; c < NUM_FACES; c++){
+      t->relabel[j][c] = c;
+    }
+    for(int i = 0; i < NUM_SIDES && !orientation_only; i++){
+      t->relabel[j][LL_SIDES[i][0]] = LL_SIDES[(i + j) % NUM_SIDES][0];
+    }
+  }
+
+  t->num_slots = 64;
+  t->slots = Calloc(t->num_slots, sizeof(int));
+  memset(t->slots, -1, t->num_slots * sizeof(int));
+  return t;
+}
+
+bool read_pattern(const case_table_t *t,
+                  const color *stickers,
+                  color *pattern){
+  //Colors are matched to faces by the centers
+  int face_of[NUM_FACES];
+  memset(face_of, -1, sizeof(face_of));
+  for(int f = 0; f < NUM_FACES; f++){
+    int c = stickers[f * FACE_LEN + CENTER];
+    if(c < 0 || c >= NUM_FACES || face_of[c] >= 0){
+      return false;
+    }
+    face_of[c] = f;
+  }
+
+  for(int i = 0; i < t->num_f2l; i++){
+    int p = t->f2l[i];
+    if(face_of[(int) stickers[p]] != p / FACE_LEN){
+      return false;
+    }
+  }
+
+  for(int i = 0; i < LL_STICKERS; i++){
+    int face = face_of[(int) stickers[t->positions[i]]];
+    pattern[i] = t->orientation_only ? face == UP : face;
+  }
+
+  return true;
+}
+
+static inline uint64_t turn_key(uint64_t key){
+  uint64_t ring = key & RING_MASK;
+  uint64_t strips = key >> RING_BITS;
+  ring = (ring >> RING_TURN) | ((ring << (RING_BITS - RING_TURN)) & RING_MASK);
+  strips = (strips >> STRIP_TURN)
+    | ((strips << (STRIP_BITS - STRIP_TURN)) & STRIP_MASK);
+  return ring | (strips << RING_BITS);
+}
+
+uint64_t canonical_key(const case_table_t *t,
+                       const color *pattern,
+                       int *turns,
+                       int *shift){
+  uint64_t best = UINT64_MAX;
+  int shifts = t->orientation_only ? 1 : NUM_SIDES;
+
+  for(int j = 0; j < shifts; j++){
+    const color *relabel = t->relabel[j];
+    uint64_t key = 0;
+    for(int i = LL_STICKERS - 1; i >= 0; i--){
+      key = (key << PATTERN_BITS) | relabel[(int) pattern[i]];
+    }
+
+    for(int r = 0; r < NUM_SIDES; r++){
+      if(key < best){
+        best = key;
+        *turns = r;
+        *shift = j;
+      }
+      key = turn_key(key);
+    }
+  }
+
+  return best;
+}
+
+int find_slot(const case_table_t *t, uint64_t key){
+  int mask = t->num_slots - 1;
+  int slot = ((key * 0x9E3779B97F4A7C15ULL) >> 40) & mask;
+  while(t->slots[slot] >= 0 && t->cases[t->slots[slot]].key != key){
+    slot = (slot + 1) & mask;
+  }
+
+  return slot;
+}
+
+void add_case_alg(case_table_t *t,
+                  uint64_t key,
+                  const char *name,
+                  alg_t *a,
+                  int turns,
+                  int shift){
+  int slot = find_slot(t, key);
+  if(t->slots[slot] < 0){
+    //Keep the table at most half full, so lookups stay short
+    if(2 * (t->num_cases + 1) > t->num_slots){
+      free(t->slots);
+      t->num_slots *= 2;
+      t->slots = Calloc(t->num_slots, sizeof(int));
+      memset(t->slots, -1, t->num_slots * sizeof(int));
+      for(int i = 0; i < t->num_cases; i++){
+        t->slots[find_slot(t, t->cases[i].key)] = i;
+      }
+      slot = find_slot(t, key);
+    }
+
+    if(t->num_cases == t->capacity){
+      t->capacity = MAX(16, t->capacity * 2);
+      case_t *bigger = Calloc(t->capacity, sizeof(case_t));
+      memcpy(bigger, t->cases, t->num_cases * sizeof(case_t));
+      free(t->cases);
+      t->cases = bigger;
+    }
+
+    case_t *c = &t->cases[t->num_cases];
+    c->name = Calloc(strlen(name) + 1, sizeof(char));
+    strcpy(c->name, name);
+    c->key = key;
+    t->slots[slot] = t->num_cases;
+    t->num_cases++;
+  }
+
+  case_t *c = &t->cases[t->slots[slot]];
+  if(c->num_algs == c->capacity){
+    c->capacity = MAX(2, c->capacity * 2);
+    alg_t **algs = Calloc(c->capacity, sizeof(alg_t *));
+    int *turn_list = Calloc(c->capacity, sizeof(int));
+    int *shift_list = Calloc(c->capacity, sizeof(int));
+    memcpy(algs, c->algs, c->num_algs * sizeof(alg_t *));
+    memcpy(turn_list, c->turns, c->num_algs * sizeof(int));
+    memcpy(shift_list, c->shifts, c->num_algs * sizeof(int));
+    free(c->algs);
+    free(c->turns);
+    free(c->shifts);
+    c->algs = algs;
+    c->turns = turn_list;
+    c->shifts = shift_list;
+  }
+  c->algs[c->num_algs] = a;
+  c->turns[c->num_algs] = turns;
+  c->shifts[c->num_algs] = shift;
+  c->num_algs++;
+}
+
+bool add_line(case_table_t *t, const char *line, int line_num){
+  //Algorithms without a name are numbered by their place in the file
+  char *name = NULL;
+  const char *moves = line;
+  const char *colon = strchr(line, ':');
+  if(colon != NULL){
+    moves = colon + 1;
+    while(line < colon && isspace(*line)){
+      line++;
+    }
+    int len = colon - line;
+    while(len > 0 && isspace(line[len - 1])){
+      len--;
+    }
+    if(len > 0){
+      name = Calloc(len + 1, sizeof(char));
+      memcpy(name, line, len);
+    }
+  }
+  if(name == NULL){
+    name = Calloc(MAX_NAME_LEN, sizeof(char));
+    snprintf(name, MAX_NAME_LEN, "case %d", line_num);
+  }
+
+  //The case an algorithm solves is what undoing it does to a solved cube
+  alg_t *a = parse_alg(SIDE_LEN, moves);
+  color stickers[NUM_STICKERS];
+  color pattern[LL_STICKERS];
+  bool ok = a != NULL;
+  if(ok){
+    alg_t *inverse = invert_alg(a);
+    state_t *s = new_state(SIDE_LEN);
+    for(int i = 0; i < inverse->len; i++){
+      apply_move(s, inverse->moves[i]);
+    }
+    state_export(s, stickers);
+    free_state(s);
+    free_alg(inverse);
+    ok = read_pattern(t, stickers, pattern);
+  }
+
+  //The centers must not move either, or the case would be read wrongly
+  for(int f = 0; ok && f < NUM_FACES; f++){
+    ok = stickers[f * FACE_LEN + CENTER] == f;
+  }
+
+  if(ok){
+    int turns;
+    int shift;
+    uint64_t key = canonical_key(t, pattern, &turns, &shift);
+    add_case_alg(t, key, name, a, turns, shift);
+  }
+  else{
+    free_alg(a);
+  }
+  free(name);
+  return ok;
+}
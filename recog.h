@@ -0,0 +1,71 @@
+#ifndef RECOG_H
+#define RECOG_H
+
+#include <stdbool.h>
+#include "alg.h"
+#include "state.h"
+
+/* The stickers of a 3x3's last layer: the eight around the center of U and
+ * the top row of each side face.
+ */
+#define LL_STICKERS 20
+
+/* A table of last layer cases, each with the algorithms for it from a
+ * library file, that states can be looked up in.
+ */
+typedef struct case_table_t case_table_t;
+
+/* The case recognize_ll found a state in. turns and shift say how the
+ * state's last layer is turned and recolored relative to the form of the
+ * case the table keeps, and are only meant for case_solution.
+ */
+typedef struct ll_match_t{
+  int index;
+  const char *name;
+  int num_algs;
+  int turns;
+  int shift;
+} ll_match_t;
+
+/* Reads a library of last layer algorithms for the 3x3. Each line is an
+ * algorithm, optionally after a name and a colon, as in "T: R U R' U' R' F
+ * R2 U' R' U' R U R' F'", and anything after a '#' is a comment. Every
+ * algorithm must leave the first two layers solved. The case each one solves
+ * is worked out from its moves, so algorithms for the same case are grouped
+ * together under the first name given for it, no matter how they are
+ * turned. Cases without a name are numbered by where their first algorithm
+ * is among the algorithms of the file. The solved last layer is always a
+ * case, named "skip". If orientation_only is true, only which stickers show
+ * the color of U is looked at, as for OLL. Returns NULL if the file could not
+ * be read or has an invalid line.
+ */
+case_table_t *load_cases(const char *path, bool orientation_only);
+
+/* Frees a table from load_cases.
+ */
+void free_cases(case_table_t *t);
+
+/* Returns how many cases are in the table.
+ */
+int num_cases(case_table_t *t);
+
+/* Finds the case of the last layer of s, a 3x3 with its first two layers
+ * solved. The last layer is compared under any turn of U before or after
+ * the algorithm, and colors are matched to faces by the centers, so any
+ * color scheme works. This only reads the stickers and does a few dozen word
+ * operations and a hash lookup, without making any moves. Returns false if s
+ * is not such a 3x3 or its case is not in the table.
+ */
+bool recognize_ll(const case_table_t *t, state_t *s, ll_match_t *match);
+
+/* Returns the moves that solve a state recognize_ll matched, with the given
+ * algorithm of its case: a turn of U if one is needed first, the algorithm,
+ * and then, unless the table is orientation only, a turn of U if one is
+ * needed to line the last layer up with the rest. Returns NULL if there is
+ * no such algorithm.
+ */
+alg_t *case_solution(const case_table_t *t,
+                     const ll_match_t *match,
+                     int which);
+
+#endif
@@ -0,0 +1,823 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "cubie.h"
+#include "helpers.h"
+#include "perm.h"
+#include "reduce.h"
+
+#define NUM_FACES 6
+#define ORBIT_SIZE 24
+#define MAX_LAYERS 3
+#define MAX_MODEL_LEN 9
+#define MAX_LIBRARY_MOVES (NUM_FACES * MAX_LAYERS * 3)
+#define MAX_BASES 8
+#define MAX_BASE_LEN 8
+#define MAX_ENTRY_LEN 64
+#define NUM_TRIPLES (ORBIT_SIZE * ORBIT_SIZE * ORBIT_SIZE)
+
+#define LIB_X_CENTERS 0
+#define LIB_OBLIQUES 1
+#define LIB_PLUS_CENTERS 2
+#define LIB_WINGS 3
+#define NUM_LIBRARIES 4
+
+//The edges swapped to fix the corners of an even cube
+#define EDGE_UB 0
+#define EDGE_UF 2
+
+/* Every kind of orbit is worked out once on a small model cube. A center
+ * (a, b) of any cube moves exactly like the center (1, 2) of a 9x9 if layer
+ * 1 stands for layer a and layer 2 for layer b, as long as the model also has
+ * layers standing in for every other kind of layer the real cube has. Those
+ * are the middle, if any, and the ones the moves never turn, which a 7x7 or
+ * 9x9 has on either side of the middle. So an algorithm that only cycles
+ * three pieces of the model only cycles the same three pieces on the cube.
+ */
+typedef struct library_t{
+  int side_len;
+  int num_layers;
+  int layers[MAX_LAYERS];     //The depths moves may turn, from any face
+  int num_moves;
+  move_t moves[MAX_LIBRARY_MOVES];
+  int inverse[MAX_LIBRARY_MOVES];
+  perm_t *perms[MAX_LIBRARY_MOVES];
+
+  int facelets;               //1 for centers, 2 for edge pieces
+  int pos[ORBIT_SIZE][2];     //The model stickers of each piece position
+  int *pos_of;                //Position * 2 + facelet of each model sticker
+
+  //Pure 3-cycles found by searching, as lists of moves
+  int num_bases;
+  int base_len[MAX_BASES];
+  int bases[MAX_BASES][MAX_BASE_LEN];
+
+  /* For every 3-cycle (p, q, r), the one it is a setup move away from. The
+   * piece at q goes to p, p to r and r to q.
+   */
+  int *parent;
+  signed char *via;
+  signed char *base;
+  int filled;
+} library_t;
+
+/* One orbit of a real cube, along with the library that solves it.
+ */
+typedef struct orbit_t{
+  library_t *lib;
+  int map[MAX_MODEL_LEN];     //The real layer each layer of the model is
+  int sticker[ORBIT_SIZE][2];
+  color colors[ORBIT_SIZE][2];
+  color target[ORBIT_SIZE][2];
+} orbit_t;
+
+static library_t libraries[NUM_LIBRARIES];
+static pthread_once_t libraries_once = PTHREAD_ONCE_INIT;
+
+/******************************
+ * HELPER FUNCTION PROTOTYPES *
+ ******************************/
+
+/* Builds every library. Only called through pthread_once.
+ */
+void build_libraries();
+
+/* Builds the library for the orbit of the center at (row, col) of a model of
+ * the given size, or for its edge pieces next to the corners if row < 0. Its
+ * moves turn the given layers.
+ */
+void build_library(library_t *lib, int side_len, int row, int col,
+                   int num_layers, const int *layers);
+
+/* Searches commutators [A, X Y X'] for pure 3-cycles of the orbit, adding
+ * each new one as a base and filling in everything it leads to.
+ */
+void find_bases(library_t *lib);
+
+/* Returns the 3-cycle that the given model moves make, or -1 if they do
+ * anything else.
+ */
+int cycle_of(library_t *lib, const int *moves, int len);
+
+/* Records how to reach the 3-cycle t, under all three of its names.
+ */
+void fill_triple(library_t *lib, int t, int parent, int via, int base);
+
+/* Fills in every 3-cycle reachable from t by setup moves.
+ */
+void spread_triple(library_t *lib, int t);
+
+/* Writes the model moves for the 3-cycle t into moves and returns how many
+ * there are.
+ */
+int entry_moves(library_t *lib, int t, int *moves);
+
+/* Returns which model sticker ends up at sticker after the given moves.
+ */
+int trace_source(library_t *lib, const int *moves, int len, int sticker);
+
+/* Sets up o for an orbit of s, with map giving the real layer each layer of
+ * the model stands for, and reads its colors.
+ */
+void set_orbit(orbit_t *o, library_t *lib, state_t *s, const int *map);
+
+/* Sets up o for the orbit of centers at (a, b) of s, where b is the middle
+ * layer for the centers on the middle lines of an odd cube.
+ */
+void set_center_orbit(orbit_t *o, state_t *s, int a, int b,
+                      const color *scheme);
+
+/* Sets up o for the orbit of edge pieces k in from the corners of s. Their
+ * targets are the middle edges of an odd cube, or the solved edges of an
+ * even one, with UF and UB swapped if swap is set.
+ */
+void set_edge_orbit(orbit_t *o, state_t *s, int k, const color *scheme,
+                    bool swap);
+
+/* Returns true if position p of o has its target colors.
+ */
+bool position_solved(orbit_t *o, int p);
+
+/* Solves o one position at a time with 3-cycles. If s is not NULL, the moves
+ * are made on s and added to out; otherwise only o's colors change. Returns
+ * false if the last two pieces are left swapped.
+ */
+bool solve_orbit(orbit_t *o, state_t *s, alg_t *out);
+
+/* Turns the middle slices of an odd cube, at most twice, until its fixed
+ * centers are where a new cube has them, making the moves on s and adding
+ * them to out. Returns false if no such turns exist.
+ */
+bool centers_home(state_t *s, alg_t *out, phase_stats_t *phase);
+
+/* Fills stickers with the 3x3 that s reduces to. The edges are the middle
+ * edges of an odd cube, or the solved edges of an even one, with UF and UB
+ * swapped if swap is set.
+ */
+void reduced_stickers(state_t *s, const color *scheme, bool swap,
+                      color *stickers);
+
+/* Returns true if opts asks for the solve to stop.
+ */
+bool cancelled(const solve_options_t *opts);
+
+/* Makes m on s, adds it to out and counts it towards the given phase.
+ */
+void add_move(state_t *s, alg_t *out, move_t m, phase_stats_t *phase);
+
+/****************************
+ * FUNCTION IMPLEMENTATIONS *
+ ****************************/
+
+void reduce_init(){
+  pthread_once(&libraries_once, build_libraries);
+}
+
+alg_t *reduce_solve(state_t *s,
+                    const solve_options_t *opts,
+                    reduce_stats_t *stats){
+  reduce_stats_t local;
+  if(stats == NULL){
+    stats = &local;
+  }
+  memset(stats, 0, sizeof(reduce_stats_t));
+  stats->phases[PHASE_PARITY].name = "parity";
+  stats->phases[PHASE_CENTERS].name = "centers";
+  stats->phases[PHASE_EDGES].name = "edges";
+  stats->phases[PHASE_3X3].name = "3x3";
+  if(s == NULL){
+    return NULL;
+  }
+
+  int n = state_side_len(s);
+  alg_t *ret = new_alg(n);
+  if(n <= 1){
+    stats->valid = true;
+    return ret;
+  }
+
+  reduce_init();
+  double start = get_time();
+  color stickers[NUM_FACES * 9];
+  cubie_t c;
+
+  //Every cube is solved to the colors of a new one, not just to solid faces
+  color scheme[NUM_FACES];
+  for(int f = 0; f < NUM_FACES; f++){
+    scheme[f] = f;
+  }
+
+  //Even cubes pair their edges so that the corners stay solvable
+  bool swap = false;
+  if(n % 2 == 0){
+    reduced_stickers(s, scheme, false, stickers);
+    if(!cubie_from_stickers(stickers, &c)){
+      swap = true;
+      reduced_stickers(s, scheme, true, stickers);
+      if(!cubie_from_stickers(stickers, &c)){
+        free_alg(ret);
+        return NULL;
+      }
+    }
+  }
+
+  state_t *work = copy_state(s);
+  orbit_t *o = Calloc(1, sizeof(orbit_t));
+  int half = (n - 2) / 2;
+  bool ok = true;
+
+  /* An odd cube turned by its middle slices is turned back, and an orbit of
+   * edge pieces left with two swapped is fixed by a slice turn, which only
+   * disturbs centers. So both have to happen first.
+   */
+  double phase_start = get_time();
+  if(n % 2 == 1){
+    ok = centers_home(work, ret, &stats->phases[PHASE_PARITY]);
+  }
+  for(int k = 1; k <= half && ok; k++){
+    set_edge_orbit(o, work, k, scheme, swap);
+    if(!solve_orbit(o, NULL, NULL)){
+      move_t m = {3, k, 1};
+      add_move(work, ret, m, &stats->phases[PHASE_PARITY]);
+      set_edge_orbit(o, work, k, scheme, swap);
+      ok = solve_orbit(o, NULL, NULL);
+    }
+  }
+  stats->phases[PHASE_PARITY].seconds = get_time() - phase_start;
+
+  phase_start = get_time();
+  int before = ret->len;
+  for(int a = 1; a <= half && ok; a++){
+    for(int b = 1; b <= half && ok; b++){
+      set_center_orbit(o, work, a, b, scheme);
+      ok = solve_orbit(o, work, ret) && !cancelled(opts);
+    }
+
+    //The centers on the middle lines of odd cubes
+    if(n % 2 == 1 && ok){
+      set_center_orbit(o, work, a, n / 2, scheme);
+      ok = solve_orbit(o, work, ret);
+    }
+  }
+  stats->phases[PHASE_CENTERS].moves = ret->len - before;
+  stats->phases[PHASE_CENTERS].seconds = get_time() - phase_start;
+
+  //The same targets as for the parity check, now solved for real
+  phase_start = get_time();
+  before = ret->len;
+  for(int k = 1; k <= half && ok; k++){
+    set_edge_orbit(o, work, k, scheme, swap);
+    ok = solve_orbit(o, work, ret) && !cancelled(opts);
+  }
+  stats->phases[PHASE_EDGES].moves = ret->len - before;
+  stats->phases[PHASE_EDGES].seconds = get_time() - phase_start;
+
+  //What is left is a 3x3 made of blocks
+  phase_start = get_time();
+  if(ok){
+    reduced_stickers(work, scheme, swap, stickers);
+    ok = cubie_from_stickers(stickers, &c);
+  }
+  if(ok){
+    alg_t *finish = twophase_solve_cubie(&c, opts, NULL);
+    ok = finish != NULL;
+    for(int i = 0; ok && i < finish->len; i++){
+      add_move(work, ret, finish->moves[i], &stats->phases[PHASE_3X3]);
+    }
+    free_alg(finish);
+  }
+  stats->phases[PHASE_3X3].seconds = get_time() - phase_start;
+
+  //The cube must end up exactly like a new one, not turned as a whole
+  if(ok){
+    state_t *solved = new_state(n);
+    ok = state_equal(work, solved);
+    free_state(solved);
+  }
+
+  free(o);
+  free_state(work);
+  if(!ok){
+    free_alg(ret);
+    return NULL;
+  }
+
+  simplify_alg(ret);
+  stats->valid = true;
+  stats->seconds = get_time() - start;
+
+  return ret;
+}
+
+/********************
+ * HELPER FUNCTIONS *
+ ********************/
+
+void build_libraries(){
+  //The centers on the middle lines can only be cycled using the middle
+  const int outer[] = {0, 1};
+  const int oblique[] = {0, 1, 2};
+  const int middle[] = {0, 1, 3};
+
+  build_library(&libraries[LIB_X_CENTERS], 7, 1, 1, 2, outer);
+  build_library(&libraries[LIB_OBLIQUES], 9, 1, 2, 3, oblique);
+  build_library(&libraries[LIB_PLUS_CENTERS], 7, 1, 3, 3, middle);
+  build_library(&libraries[LIB_WINGS], 7, -1, 0, 2, outer);
+}
+
+void build_library(library_t *lib, int side_len, int row, int col,
+                   int num_layers, const int *layers){
+  lib->side_len = side_len;
+  lib->num_layers = num_layers;
+  memcpy(lib->layers, layers, num_layers * sizeof(int));
+
+  //Every turn of every layer the library may use
+  lib->num_moves = 0;
+  for(int face = 0; face < NUM_FACES; face++){
+    for(int i = 0; i < num_layers; i++){
+      for(int turns = 1; turns <= 3; turns++){
+        move_t m = {face, layers[i], turns};
+        alg_t *a = new_alg(side_len);
+        alg_append(a, m);
+        lib->moves[lib->num_moves] = m;
+        lib->inverse[lib->num_moves] = lib->num_moves + 4 - 2 * turns;
+        lib->perms[lib->num_moves] = compile_alg(a);
+        lib->num_moves++;
+        free_alg(a);
+      }
+    }
+  }
+
+  //The positions of the orbit, each face's four in clockwise order
+  int face_len = side_len * side_len;
+  lib->facelets = row < 0 ? 2 : 1;
+  for(int p = 0; p < ORBIT_SIZE; p++){
+    if(row < 0){
+      int k = p % 2 == 0 ? 1 : side_len - 2;
+      lib->pos[p][0] = edge_facelet(side_len, p / 2, 0, k);
+      lib->pos[p][1] = edge_facelet(side_len, p / 2, 1, k);
+      continue;
+    }
+
+    int r = row;
+    int c = col;
+    for(int i = 0; i < p % 4; i++){
+      int t = r;
+      r = c;
+      c = side_len - 1 - t;
+    }
+    lib->pos[p][0] = (p / 4) * face_len + get_coord(c, r, side_len);
+  }
+
+  lib->pos_of = Calloc(NUM_FACES * face_len, sizeof(int));
+  for(int i = 0; i < NUM_FACES * face_len; i++){
+    lib->pos_of[i] = -1;
+  }
+  for(int p = 0; p < ORBIT_SIZE; p++){
+    for(int j = 0; j < lib->facelets; j++){
+      lib->pos_of[lib->pos[p][j]] = p * 2 + j;
+    }
+  }
+
+  lib->parent = Calloc(NUM_TRIPLES, sizeof(int));
+  lib->via = Calloc(NUM_TRIPLES, sizeof(signed char));
+  lib->base = Calloc(NUM_TRIPLES, sizeof(signed char));
+  memset(lib->base, -1, NUM_TRIPLES);
+  find_bases(lib);
+}
+
+void find_bases(library_t *lib){
+  int total = ORBIT_SIZE * (ORBIT_SIZE - 1) * (ORBIT_SIZE - 2);
+  for(int a = 0; a < lib->num_moves; a++){
+    if(lib->moves[a].depth == 0 || lib->moves[a].turns != 1){
+      continue;
+    }
+
+    for(int x = -1; x < lib->num_moves; x++){
+      for(int y = 0; y < lib->num_moves; y++){
+        if(lib->moves[y].turns != 1 || lib->num_bases == MAX_BASES){
+          continue;
+        }
+
+        //[A, X Y X'], or just [A, Y] with no X
+        int moves[MAX_BASE_LEN];
+        int len = 0;
+        moves[len++] = a;
+        if(x >= 0){
+          moves[len++] = x;
+        }
+        moves[len++] = y;
+        if(x >= 0){
+          moves[len++] = lib->inverse[x];
+        }
+        moves[len++] = lib->inverse[a];
+        if(x >= 0){
+          moves[len++] = x;
+        }
+        moves[len++] = lib->inverse[y];
+        if(x >= 0){
+          moves[len++] = lib->inverse[x];
+        }
+
+        int t = cycle_of(lib, moves, len);
+        if(t < 0 || lib->base[t] >= 0){
+          continue;
+        }
+
+        int b = lib->num_bases;
+        memcpy(lib->bases[b], moves, len * sizeof(int));
+        lib->base_len[b] = len;
+        lib->num_bases++;
+        fill_triple(lib, t, -1, -1, b);
+        spread_triple(lib, t);
+        if(lib->filled == total){
+          return;
+        }
+      }
+    }
+  }
+}
+
+int cycle_of(library_t *lib, const int *moves, int len){
+  int from[ORBIT_SIZE];
+  for(int p = 0; p < ORBIT_SIZE; p++){
+    from[p] = -1;
+  }
+
+  //Anything moving outside the orbit, or a piece twisting in place, is out
+  for(int x = 0; x < lib->perms[0]->size; x++){
+    int y = trace_source(lib, moves, len, x);
+    if(y == x){
+      continue;
+    }
+    if(lib->pos_of[x] < 0 || lib->pos_of[y] < 0){
+      return -1;
+    }
+
+    int p = lib->pos_of[x] / 2;
+    int q = lib->pos_of[y] / 2;
+    if(p == q || (from[p] >= 0 && from[p] != q)){
+      return -1;
+    }
+    from[p] = q;
+  }
+
+  int moved = 0;
+  int p = -1;
+  for(int i = 0; i < ORBIT_SIZE; i++){
+    if(from[i] >= 0){
+      moved++;
+      p = i;
+    }
+  }
+  if(moved != 3){
+    return -1;
+  }
+
+  int q = from[p];
+  int r = from[q];
+  if(r < 0 || from[r] != p){
+    return -1;
+  }
+
+  return (p * ORBIT_SIZE + q) * ORBIT_SIZE + r;
+}
+
+void fill_triple(library_t *lib, int t, int parent, int via, int base){
+  int p = t / (ORBIT_SIZE * ORBIT_SIZE);
+  int q = t / ORBIT_SIZE % ORBIT_SIZE;
+  int r = t % ORBIT_SIZE;
+  int names[3] = {
+    t,
+    (q * ORBIT_SIZE + r) * ORBIT_SIZE + p,
+    (r * ORBIT_SIZE + p) * ORBIT_SIZE + q
+  };
+
+  for(int i = 0; i < 3; i++){
+    lib->parent[names[i]] = parent;
+    lib->via[names[i]] = via;
+    lib->base[names[i]] = base;
+    lib->filled++;
+  }
+}
+
+void spread_triple(library_t *lib, int t){
+  //A breadth first search, so every 3-cycle gets its shortest setup
+  int *queue = Calloc(NUM_TRIPLES, sizeof(int));
+  int head = 0;
+  int tail = 0;
+  queue[tail++] = t;
+
+  while(head < tail){
+    int u = queue[head++];
+    int pos[3] = {
+      u / (ORBIT_SIZE * ORBIT_SIZE), u / ORBIT_SIZE % ORBIT_SIZE,
+      u % ORBIT_SIZE
+    };
+
+    for(int m = 0; m < lib->num_moves; m++){
+      //The positions that m brings into the 3-cycle u
+      int next = 0;
+      for(int i = 0; i < 3; i++){
+        int src = lib->perms[m]->src[lib->pos[pos[i]][0]];
+        next = next * ORBIT_SIZE + lib->pos_of[src] / 2;
+      }
+
+      if(lib->base[next] < 0){
+        fill_triple(lib, next, u, m, lib->base[u]);
+        queue[tail++] = next;
+      }
+    }
+  }
+
+  free(queue);
+}
+
+int entry_moves(library_t *lib, int t, int *moves){
+  //A 3-cycle is its parent's, set up by one more move and undone after
+  int setup[MAX_ENTRY_LEN];
+  int depth = 0;
+  for(int u = t; lib->parent[u] >= 0; u = lib->parent[u]){
+    setup[depth++] = lib->via[u];
+  }
+
+  int len = 0;
+  for(int i = 0; i < depth; i++){
+    moves[len++] = setup[i];
+  }
+  int b = lib->base[t];
+  for(int i = 0; i < lib->base_len[b]; i++){
+    moves[len++] = lib->bases[b][i];
+  }
+  for(int i = depth - 1; i >= 0; i--){
+    moves[len++] = lib->inverse[setup[i]];
+  }
+
+  return len;
+}
+
+int trace_source(library_t *lib, const int *moves, int len, int sticker){
+  for(int i = len - 1; i >= 0; i--){
+    sticker = lib->perms[moves[i]]->src[sticker];
+  }
+
+  return sticker;
+}
+
+void set_orbit(orbit_t *o, library_t *lib, state_t *s, const int *map){
+  int m = lib->side_len;
+  int n = state_side_len(s);
+  o->lib = lib;
+  memcpy(o->map, map, sizeof(o->map));
+
+  for(int p = 0; p < ORBIT_SIZE; p++){
+    for(int j = 0; j < lib->facelets; j++){
+      int model = lib->pos[p][j];
+      int face = model / (m * m);
+      int row = model % (m * m) / m;
+      int col = model % m;
+      o->sticker[p][j] = face * n * n + get_coord(map[col], map[row], n);
+      o->colors[p][j] = state_sticker(s, o->sticker[p][j]);
+    }
+  }
+}
+
+void set_center_orbit(orbit_t *o, state_t *s, int a, int b,
+                      const color *scheme){
+  int n = state_side_len(s);
+  library_t *lib = &libraries[LIB_OBLIQUES];
+  if(a == b){
+    lib = &libraries[LIB_X_CENTERS];
+  }
+  else if(n % 2 == 1 && b == n / 2){
+    lib = &libraries[LIB_PLUS_CENTERS];
+  }
+
+  //Layer 1 stands for a and the next one in for b, or the middle
+  int m = lib->side_len;
+  int map[MAX_MODEL_LEN];
+  memset(map, -1, sizeof(map));
+  map[0] = 0;
+  map[1] = a;
+  map[m - 2] = n - 1 - a;
+  map[m - 1] = n - 1;
+  if(lib == &libraries[LIB_OBLIQUES]){
+    map[2] = b;
+    map[m - 3] = n - 1 - b;
+  }
+  if(n % 2 == 1){
+    map[m / 2] = n / 2;
+  }
+
+  set_orbit(o, lib, s, map);
+  for(int p = 0; p < ORBIT_SIZE; p++){
+    o->target[p][0] = scheme[o->sticker[p][0] / (n * n)];
+  }
+}
+
+void set_edge_orbit(orbit_t *o, state_t *s, int k, const color *scheme,
+                    bool swap){
+  int n = state_side_len(s);
+  library_t *lib = &libraries[LIB_WINGS];
+  int m = lib->side_len;
+  int map[MAX_MODEL_LEN];
+  memset(map, -1, sizeof(map));
+  map[0] = 0;
+  map[1] = k;
+  map[m - 2] = n - 1 - k;
+  map[m - 1] = n - 1;
+
+  set_orbit(o, lib, s, map);
+  for(int p = 0; p < ORBIT_SIZE; p++){
+    int faces[2];
+    int edge = p / 2;
+    if(swap && (edge == EDGE_UF || edge == EDGE_UB)){
+      edge = EDGE_UF + EDGE_UB - edge;
+    }
+    edge_faces(edge, faces);
+
+    for(int i = 0; i < 2; i++){
+      o->target[p][i] = n % 2 == 1
+        ? state_sticker(s, edge_facelet(n, p / 2, i, n / 2))
+        : scheme[faces[i]];
+    }
+  }
+}
+
+bool position_solved(orbit_t *o, int p){
+  for(int j = 0; j < o->lib->facelets; j++){
+    if(o->colors[p][j] != o->target[p][j]){
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool solve_orbit(orbit_t *o, state_t *s, alg_t *out){
+  library_t *lib = o->lib;
+  bool locked[ORBIT_SIZE] = {false};
+  int moves[MAX_ENTRY_LEN];
+
+  for(int p = 0; p < ORBIT_SIZE; p++){
+    if(position_solved(o, p)){
+      locked[p] = true;
+      continue;
+    }
+
+    /* Bring a piece that belongs at p there, sending p's piece somewhere
+     * not yet solved. Once only p and that piece's place are left, the third
+     * position has to be a solved one that gets an identical piece back.
+     */
+    bool done = false;
+    for(int q = 0; q < ORBIT_SIZE && !done; q++){
+      if(q == p || locked[q]){
+        continue;
+      }
+      for(int pass = 0; pass < 2 && !done; pass++){
+        for(int r = 0; r < ORBIT_SIZE && !done; r++){
+          if(r == p || r == q || locked[r] != (pass == 1)){
+            continue;
+          }
+          int t = (p * ORBIT_SIZE + q) * ORBIT_SIZE + r;
+          if(lib->base[t] < 0){
+            continue;
+          }
+
+          int len = entry_moves(lib, t, moves);
+          int cycle[3] = {p, q, r};
+          color after[3][2];
+          for(int i = 0; i < 3; i++){
+            for(int j = 0; j < lib->facelets; j++){
+              int src = lib->pos_of[trace_source(lib, moves, len,
+                                                 lib->pos[cycle[i]][j])];
+              after[i][j] = o->colors[src / 2][src % 2];
+            }
+          }
+
+          //Whether q's piece fits at p doesn't depend on r
+          bool fits = true;
+          bool r_fits = true;
+          for(int j = 0; j < lib->facelets; j++){
+            fits = fits && after[0][j] == o->target[p][j];
+            r_fits = r_fits && after[2][j] == o->target[r][j];
+          }
+          if(!fits){
+            pass = 2;
+            break;
+          }
+          if(pass == 1 && !r_fits){
+            continue;
+          }
+
+          for(int i = 0; i < 3; i++){
+            memcpy(o->colors[cycle[i]], after[i], sizeof(after[i]));
+          }
+          for(int i = 0; s != NULL && i < len; i++){
+            move_t m = lib->moves[moves[i]];
+            m.depth = o->map[m.depth];
+            apply_move(s, m);
+            alg_append(out, m);
+          }
+          done = true;
+        }
+      }
+    }
+
+    if(!done){
+      return false;
+    }
+    locked[p] = true;
+  }
+
+  return true;
+}
+
+bool centers_home(state_t *s, alg_t *out, phase_stats_t *phase){
+  int n = state_side_len(s);
+
+  //The fixed centers move just like those of a 3x3 turned by its middle
+  color stickers[NUM_FACES * 9] = {0};
+  for(int f = 0; f < NUM_FACES; f++){
+    stickers[f * 9 + 4]
+      = state_sticker(s, f * n * n + get_coord(n / 2, n / 2, n));
+  }
+
+  /* Every way of holding a cube is at most two turns of the middle slices
+   * away. Turns are numbered from 0 to 8 by axis and direction, and -1 is
+   * no turn, so shorter sequences come first.
+   */
+  const int faces[] = {2, 3, 5};
+  for(int i = 0; i < 100; i++){
+    int seq[2] = {i % 10 - 1, i / 10 - 1};
+    move_t moves[2];
+    state_t *model = state_import(3, stickers);
+    for(int j = 0; j < 2; j++){
+      moves[j].face = faces[MAX(seq[j], 0) / 3];
+      moves[j].depth = 1;
+      moves[j].turns = MAX(seq[j], 0) % 3 + 1;
+      if(seq[j] >= 0){
+        apply_move(model, moves[j]);
+      }
+    }
+
+    bool home = true;
+    for(int f = 0; f < NUM_FACES; f++){
+      home = home && state_sticker(model, f * 9 + 4) == f;
+    }
+    free_state(model);
+    if(!home){
+      continue;
+    }
+
+    for(int j = 0; j < 2; j++){
+      if(seq[j] >= 0){
+        moves[j].depth = n / 2;
+        add_move(s, out, moves[j], phase);
+      }
+    }
+    return true;
+  }
+
+  return false;
+}
+
+void reduced_stickers(state_t *s, const color *scheme, bool swap,
+                      color *stickers){
+  int n = state_side_len(s);
+  for(int f = 0; f < NUM_FACES; f++){
+    stickers[f * 9 + 4] = scheme[f];
+  }
+  for(int c = 0; c < NUM_CORNERS; c++){
+    for(int i = 0; i < 3; i++){
+      stickers[corner_facelet(3, c, i)]
+        = state_sticker(s, corner_facelet(n, c, i));
+    }
+  }
+
+  for(int e = 0; e < NUM_EDGES; e++){
+    int faces[2];
+    int edge = e;
+    if(swap && (e == EDGE_UF || e == EDGE_UB)){
+      edge = EDGE_UF + EDGE_UB - e;
+    }
+    edge_faces(edge, faces);
+
+    for(int i = 0; i < 2; i++){
+      stickers[edge_facelet(3, e, i, 1)] = n % 2 == 1
+        ? state_sticker(s, edge_facelet(n, e, i, n / 2))
+        : scheme[faces[i]];
+    }
+  }
+}
+
+bool cancelled(const solve_options_t *opts){
+  return opts != NULL && opts->cancel != NULL && opts->cancel(opts->cancel_arg);
+}
+
+void add_move(state_t *s, alg_t *out, move_t m, phase_stats_t *phase){
+  apply_move(s, m);
+  alg_append(out, m);
+  phase->moves++;
+}
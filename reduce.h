@@ -0,0 +1,56 @@
+#ifndef REDUCE_H
+#define REDUCE_H
+
+#include <stdbool.h>
+#include "alg.h"
+#include "state.h"
+#include "twophase.h"
+
+#define NUM_REDUCE_PHASES 4
+
+/* The phases of a reduction solve, in the order they run.
+ */
+#define PHASE_PARITY 0
+#define PHASE_CENTERS 1
+#define PHASE_EDGES 2
+#define PHASE_3X3 3
+
+/* How many moves a phase added to the solution, before simplifying, and how
+ * long it took.
+ */
+typedef struct phase_stats_t{
+  const char *name;
+  int moves;
+  double seconds;
+} phase_stats_t;
+
+/* What a call to reduce_solve did. valid is false if the cube could not be
+ * solved at all.
+ */
+typedef struct reduce_stats_t{
+  bool valid;
+  phase_stats_t phases[NUM_REDUCE_PHASES];
+  double seconds;
+} reduce_stats_t;
+
+/* Builds the commutator libraries the solver uses. Like twophase_init, this
+ * only does any work the first time and reduce_solve calls it itself.
+ */
+void reduce_init();
+
+/* Solves a cube of any size by reduction, back to exactly the cube new_state
+ * makes. An odd cube's middle slices are first turned so its fixed centers
+ * are where they belong. Every orbit of centers is solved, then every orbit
+ * of edge pieces is paired up, each with pure 3-cycles that leave the rest
+ * of the cube alone. An odd edge orbit is first fixed with a
+ * single slice turn, and on even cubes the edges are paired so that the
+ * corners are still solvable. What is left is solved as a 3x3 with
+ * twophase_solve using opts, which may be NULL. The cancel callback in opts
+ * is also checked between orbits. Returns NULL if s can not be solved or the
+ * solve was cancelled. stats may be NULL.
+ */
+alg_t *reduce_solve(state_t *s,
+                    const solve_options_t *opts,
+                    reduce_stats_t *stats);
+
+#endif
@@ -0,0 +1,415 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "helpers.h"
+#include "replay.h"
+
+#define INDEX_MAGIC "CUBEIDX2"
+#define PROGRESS_MASK 0xFFFF
+#define PROGRESS_SECONDS 0.5
+#define HASH_SPAN 4096
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+/* The start of an index file. It is followed by count checkpoints, each an
+ * index_entry_t and then the exported stickers of the state at that point.
+ * The size, modification time and log_hash of the log it was made from are
+ * kept so that an index for a log that has since changed is not trusted.
+ */
+typedef struct index_header_t{
+  char magic[8];
+  int64_t side_len;
+  int64_t interval;
+  int64_t count;
+  int64_t log_size;
+  int64_t log_mtime_sec;
+  int64_t log_mtime_nsec;
+  uint64_t log_hash;
+} index_header_t;
+
+typedef struct index_entry_t{
+  int64_t move_num;
+  int64_t offset;       //Where in the log the move after this one starts
+} index_entry_t;
+
+/* A log mapped into memory.
+ */
+typedef struct log_map_t{
+  const char *data;
+  size_t size;
+  struct timespec mtime;
+} log_map_t;
+
+/******************************
+ * HELPER FUNCTION PROTOTYPES *
+ ******************************/
+
+/* Maps the log at path into memory. Returns false if it could not be read.
+ */
+bool map_log(const char *path, log_map_t *map);
+
+/* Unmaps a log mapped by map_log.
+ */
+void unmap_log(log_map_t *map);
+
+/* Returns a hash of the first and last HASH_SPAN bytes of a log, which
+ * together with its size and modification time is enough to tell whether an
+ * index still matches it without reading the whole log.
+ */
+uint64_t log_hash(log_map_t *map);
+
+/* Returns true if an index header was made from the mapped log.
+ */
+bool header_matches(const index_header_t *header, log_map_t *map);
+
+/* Returns a newly allocated string with the path of the index for a log.
+ */
+char *index_path(const char *path);
+
+/* Reads the next move at or after *offset into m, leaving *offset just past
+ * it. Returns 0 at the end of the log, 1 for a move and -1 for an invalid
+ * move.
+ */
+int next_move(log_map_t *map, size_t *offset, move_t *m);
+
+/* Applies moves from the log to s, starting at *offset, until stop_at moves
+ * have been made in total or the log ends. Writes checkpoints to index if it
+ * is not NULL. Returns false on an invalid move.
+ */
+bool run_log(log_map_t *map,
+             size_t *offset,
+             state_t *s,
+             long stop_at,
+             long interval,
+             FILE *index,
+             bool progress,
+             replay_stats_t *stats);
+
+/* Appends a checkpoint of s to the index.
+ */
+void write_checkpoint(FILE *index, state_t *s, long move_num, size_t offset);
+
+/****************************
+ * FUNCTION IMPLEMENTATIONS *
+ ****************************/
+
+state_t *replay_log(const char *path,
+                    int side_len,
+                    long stop_at,
+                    long interval,
+                    bool progress,
+                    bool packed,
+                    replay_stats_t *stats){
+  replay_stats_t local;
+  if(stats == NULL){
+    stats = &local;
+  }
+  memset(stats, 0, sizeof(replay_stats_t));
+
+  log_map_t map;
+  if(!map_log(path, &map)){
+    return NULL;
+  }
+
+  //Start the index, filling in the number of checkpoints at the end
+  FILE *index = NULL;
+  index_header_t header;
+  if(interval > 0){
+    char *idx_path = index_path(path);
+    index = fopen(idx_path, "wb");
+    if(index == NULL){
+      fprintf(stderr, "Could not write %s\n", idx_path);
+    }
+    free(idx_path);
+
+    memset(&header, 0, sizeof(index_header_t));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.side_len = side_len;
+    header.interval = interval;
+    header.log_size = map.size;
+    header.log_mtime_sec = map.mtime.tv_sec;
+    header.log_mtime_nsec = map.mtime.tv_nsec;
+    header.log_hash = log_hash(&map);
+    if(index != NULL){
+      fwrite(&header, sizeof(index_header_t), 1, index);
+    }
+  }
+
+  state_t *s = new_state(side_len);
+  state_set_packed(s, packed);
+  size_t offset = 0;
+  double start = get_time();
+
+  if(index != NULL){
+    write_checkpoint(index, s, 0, 0);
+    stats->checkpoints++;
+  }
+  bool ok = run_log(&map, &offset, s, stop_at, interval, index, progress,
+                    stats);
+  stats->seconds = get_time() - start;
+
+  if(index != NULL){
+    header.count = stats->checkpoints;
+    fseek(index, 0, SEEK_SET);
+    fwrite(&header, sizeof(index_header_t), 1, index);
+    fclose(index);
+  }
+  unmap_log(&map);
+
+  if(!ok){
+    free_state(s);
+    return NULL;
+  }
+
+  return s;
+}
+
+state_t *seek_log(const char *path,
+                  int side_len,
+                  long move_num,
+                  bool packed,
+                  replay_stats_t *stats){
+  replay_stats_t local;
+  if(stats == NULL){
+    stats = &local;
+  }
+  memset(stats, 0, sizeof(replay_stats_t));
+
+  log_map_t map;
+  if(!map_log(path, &map)){
+    return NULL;
+  }
+
+  //Find the nearest checkpoint, if there is an index that matches this log
+  state_t *s = NULL;
+  size_t offset = 0;
+  char *idx_path = index_path(path);
+  FILE *index = fopen(idx_path, "rb");
+  free(idx_path);
+
+  index_header_t header;
+  if(index != NULL
+     && fread(&header, sizeof(index_header_t), 1, index) == 1
+     && memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) == 0
+     && header.side_len == side_len
+     && header_matches(&header, &map)
+     && header.interval > 0
+     && header.count > 0){
+    long num_stickers = 6L * side_len * side_len;
+    long entry_size = sizeof(index_entry_t) + num_stickers;
+    long k = MIN(move_num / header.interval, header.count - 1);
+
+    index_entry_t entry;
+    color *stickers = Calloc(num_stickers, sizeof(color));
+    if(fseek(index, sizeof(index_header_t) + k * entry_size, SEEK_SET) == 0
+       && fread(&entry, sizeof(index_entry_t), 1, index) == 1
+       && fread(stickers, 1, num_stickers, index) == (size_t) num_stickers){
+      s = state_import(side_len, stickers);
+      offset = entry.offset;
+      stats->position = entry.move_num;
+    }
+    free(stickers);
+  }
+  if(index != NULL){
+    fclose(index);
+  }
+
+  if(s == NULL){
+    s = new_state(side_len);
+  }
+  state_set_packed(s, packed);
+
+  double start = get_time();
+  bool ok = run_log(&map, &offset, s, move_num, 0, NULL, false, stats);
+  stats->seconds = get_time() - start;
+  unmap_log(&map);
+
+  if(!ok){
+    free_state(s);
+    return NULL;
+  }
+
+  return s;
+}
+
+/********************
+ * HELPER FUNCTIONS *
+ ********************/
+
+bool map_log(const char *path, log_map_t *map){
+  map->data = NULL;
+  map->size = 0;
+
+  int fd = open(path, O_RDONLY);
+  if(fd < 0){
+    fprintf(stderr, "Could not open %s\n", path);
+    return false;
+  }
+
+  struct stat st;
+  if(fstat(fd, &st) != 0){
+    fprintf(stderr, "Could not read %s\n", path);
+    close(fd);
+    return false;
+  }
+  map->size = st.st_size;
+  map->mtime = st.st_mtim;
+
+  //An empty log has nothing to map
+  if(map->size > 0){
+    void *data = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED){
+      fprintf(stderr, "Could not map %s\n", path);
+      close(fd);
+      return false;
+    }
+    posix_madvise(data, map->size, POSIX_MADV_SEQUENTIAL);
+    map->data = data;
+  }
+
+  close(fd);
+  return true;
+}
+
+void unmap_log(log_map_t *map){
+  if(map->data != NULL){
+    munmap((void *) map->data, map->size);
+  }
+  map->data = NULL;
+  map->size = 0;
+}
+
+uint64_t log_hash(log_map_t *map){
+  uint64_t hash = FNV_OFFSET;
+  size_t head = MIN(map->size, HASH_SPAN);
+  for(size_t i = 0; i < head; i++){
+    hash = (hash ^ (unsigned char) map->data[i]) * FNV_PRIME;
+  }
+
+  //The tail starts after the head so short logs are not hashed twice
+  size_t tail = map->size > HASH_SPAN ? MAX(map->size - HASH_SPAN, head) : 0;
+  for(size_t i = tail; i < map->size; i++){
+    hash = (hash ^ (unsigned char) map->data[i]) * FNV_PRIME;
+  }
+
+  return hash;
+}
+
+bool header_matches(const index_header_t *header, log_map_t *map){
+  return header->log_size == (int64_t) map->size
+         && header->log_mtime_sec == (int64_t) map->mtime.tv_sec
+         && header->log_mtime_nsec == (int64_t) map->mtime.tv_nsec
+         && header->log_hash == log_hash(map);
+}
+
+char *index_path(const char *path){
+  char *ret = Calloc(strlen(path) + strlen(INDEX_SUFFIX) + 1, sizeof(char));
+  strcpy(ret, path);
+  strcat(ret, INDEX_SUFFIX);
+
+  return ret;
+}
+
+int next_move(log_map_t *map, size_t *offset, move_t *m){
+  size_t i = *offset;
+
+  //Skip separators
+  while(i < map->size && (isspace(map->data[i]) || map->data[i] == ',')){
+    i++;
+  }
+  if(i >= map->size){
+    *offset = i;
+    return 0;
+  }
+
+  //The log is not NULL-Terminated, so copy the move out to parse it
+  char token[MAX_MOVE_STR_LEN];
+  int len = 0;
+  while(i < map->size && !isspace(map->data[i]) && map->data[i] != ','){
+    if(len < MAX_MOVE_STR_LEN - 1){
+      token[len] = map->data[i];
+    }
+    len++;
+    i++;
+  }
+  *offset = i;
+
+  if(len >= MAX_MOVE_STR_LEN){
+    return -1;
+  }
+  token[len] = '\0';
+
+  return parse_move(token, m) ? 1 : -1;
+}
+
+bool run_log(log_map_t *map,
+             size_t *offset,
+             state_t *s,
+             long stop_at,
+             long interval,
+             FILE *index,
+             bool progress,
+             replay_stats_t *stats){
+  double start = get_time();
+  double last_report = start;
+  move_t m;
+  int result = 0;
+
+  while((stop_at < 0 || stats->position < stop_at)
+        && (result = next_move(map, offset, &m)) > 0){
+    apply_move(s, m);
+    stats->moves++;
+    stats->position++;
+
+    if(index != NULL && stats->position % interval == 0){
+      write_checkpoint(index, s, stats->position, *offset);
+      stats->checkpoints++;
+    }
+
+    //Only look at the clock every so often, it costs more than a move
+    if(progress && (stats->moves & PROGRESS_MASK) == 0){
+      double now = get_time();
+      if(now - last_report >= PROGRESS_SECONDS){
+        fprintf(stderr, "\r%ld moves, %.0f moves/s, %.1f%%",
+                stats->position, stats->moves / (now - start),
+                100.0 * *offset / map->size);
+        last_report = now;
+      }
+    }
+  }
+  if(progress && last_report != start){
+    fprintf(stderr, "\n");
+  }
+
+  if(result < 0){
+    fprintf(stderr, "Invalid move after move %ld\n", stats->position);
+    return false;
+  }
+
+  return true;
+}
+
+void write_checkpoint(FILE *index, state_t *s, long move_num, size_t offset){
+  int side_len = state_side_len(s);
+  long num_stickers = 6L * side_len * side_len;
+  color *stickers = Calloc(num_stickers, sizeof(color));
+  state_export(s, stickers);
+
+  index_entry_t entry;
+  entry.move_num = move_num;
+  entry.offset = offset;
+  fwrite(&entry, sizeof(index_entry_t), 1, index);
+  fwrite(stickers, 1, num_stickers, index);
+
+  free(stickers);
+}
@@ -0,0 +1,54 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include "state.h"
+
+/* Move logs are plain text files of moves written the way make_move expects
+ * them, separated by whitespace or commas. A log can have a sidecar index,
+ * named after the log with INDEX_SUFFIX added, holding a copy of the state
+ * every so many moves so that any point in the log can be reached quickly.
+ */
+#define INDEX_SUFFIX ".idx"
+
+/* What happened during a replay.
+ */
+typedef struct replay_stats_t{
+  long moves;           //Moves applied, not counting those skipped by a seek
+  long position;        //Number of the last move in the state returned
+  long checkpoints;     //Checkpoints written to the index
+  double seconds;
+} replay_stats_t;
+
+/* Applies the log at path to a new cube of side_len, stopping after stop_at
+ * moves unless stop_at is negative. If interval is positive, an index with a
+ * checkpoint every interval moves is written alongside the log. If progress
+ * is true, the number of moves applied and the rate are reported on stderr
+ * as the replay goes. If packed is true, the cube is packed with
+ * state_set_packed. Returns the final state, or NULL if the log could not be
+ * read or contained an invalid move. stats may be NULL.
+ */
+state_t *replay_log(const char *path,
+                    int side_len,
+                    long stop_at,
+                    long interval,
+                    bool progress,
+                    bool packed,
+                    replay_stats_t *stats);
+
+/* Returns the state after the first move_num moves of the log at path. The
+ * nearest checkpoint at or before move_num is loaded from the log's index, so
+ * fewer than one interval of moves is replayed. The index is only used if
+ * the log still has the size, modification time and first and last few
+ * kilobytes it had when the index was written, so an index left over from
+ * an edited log is ignored. Without a usable index this falls back to
+ * replaying from the start. packed is as in replay_log. stats
+ * may be NULL.
+ */
+state_t *seek_log(const char *path,
+                  int side_len,
+                  long move_num,
+                  bool packed,
+                  replay_stats_t *stats);
+
+#endif
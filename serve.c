@@ -0,0 +1,725 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "alg.h"
+#include "helpers.h"
+#include "perm.h"
+#include "reduce.h"
+#include "serve.h"
+#include "state.h"
+#include "twophase.h"
+#include "verify.h"
+
+#define NUM_FACES 6
+#define MAX_SERVE_SIZE 100
+#define MAX_BATCH 16
+#define MAX_SAMPLES 65536
+#define MAX_COMMAND_LEN 16
+
+/* The commands latencies are kept for. Anything else counts as other.
+ */
+#define CMD_SOLVE 0
+#define CMD_APPLY 1
+#define CMD_ORDER 2
+#define CMD_VERIFY 3
+#define CMD_OTHER 4
+#define NUM_COMMANDS 5
+
+static const char *COMMAND_NAMES[NUM_COMMANDS] = {
+  "solve", "apply", "order", "verify", "other"
+};
+
+/* A request waiting for, or being handled by, a worker.
+ */
+typedef struct job_t{
+  char *request;
+  char *response;
+  bool done;
+  struct job_t *next;
+} job_t;
+
+/* How long the requests for one command took, in seconds. Only the last
+ * MAX_SAMPLES are kept, in a ring.
+ */
+typedef struct latency_t{
+  long count;
+  double samples[MAX_SAMPLES];
+} latency_t;
+
+/* Everything the threads of a server share, guarded by lock.
+ */
+typedef struct server_t{
+  int listen_fd;
+  int workers;
+  pthread_mutex_t lock;
+  pthread_cond_t queued;      //Signalled when a job is added, or on stopping
+  pthread_cond_t finished;    //Broadcast when jobs are done or answered
+
+  job_t *head;
+  job_t *tail;
+  int queue_len;
+  int in_flight;              //Jobs taken in but not yet answered
+  bool stopping;
+
+  long batches;
+  long batched_jobs;
+  latency_t latencies[NUM_COMMANDS];
+} server_t;
+
+/* What each connection's thread is given.
+ */
+typedef struct connection_t{
+  server_t *server;
+  int fd;
+} connection_t;
+
+/******************************
+ * HELPER FUNCTION PROTOTYPES *
+ ******************************/
+
+/* Reads or writes exactly len bytes, retrying when interrupted. Returns false
+ * if the connection failed or, for read_all, closed.
+ */
+bool read_all(int fd, void *buf, size_t len);
+bool write_all(int fd, const void *buf, size_t len);
+
+/* Returns a socket listening at path, replacing a stale socket left there,
+ * or -1 if it could not be made.
+ */
+int listen_at(const char *path);
+
+/* The body of each connection's thread: reads requests, queues them and
+ * sends back each response once a worker has it.
+ */
+void *connection_thread(void *arg);
+
+/* The body of each worker thread: takes batches of jobs off the queue until
+ * the server stops and the queue is empty.
+ */
+void *worker_thread(void *arg);
+
+/* Returns which command request is for.
+ */
+int command_of(const char *request);
+
+/* Returns true if request is the shutdown command on its own.
+ */
+bool is_shutdown(const char *request);
+
+/* Returns a new response, "ok " or "error " followed by the formatted text.
+ */
+char *respond(bool ok, const char *format, ...);
+
+/* Returns the response to a single request.
+ */
+char *handle_request(server_t *server, const char *request);
+
+/* Reads the size after the command word of request into *side_len, and
+ * points *rest at what follows it. Returns false if there is no valid size.
+ */
+bool parse_size(const char *request, int *side_len, const char **rest);
+
+/* The commands, each given what follows the size.
+ */
+char *handle_solve(int side_len, const char *rest);
+char *handle_apply(int side_len, const char *rest);
+char *handle_order(int side_len, const char *rest);
+char *handle_verify(int side_len, const char *rest);
+
+/* Returns how many requests there have been, followed by a line with the
+ * latency percentiles of each command so far.
+ */
+char *latency_report(server_t *server);
+
+/* For qsort.
+ */
+int compare_doubles(const void *a, const void *b);
+
+/****************************
+ * FUNCTION IMPLEMENTATIONS *
+ ****************************/
+
+int serve(const serve_options_t *opts){
+  server_t *server = Calloc(1, sizeof(server_t));
+  server->workers = MAX(1, opts->workers);
+  server->listen_fd = listen_at(opts->socket_path);
+  if(server->listen_fd < 0){
+    free(server);
+    return 1;
+  }
+
+  //Get the tables ready before taking any requests
+  double start = get_time();
+  if(opts->tables_path != NULL && !twophase_load_tables(opts->tables_path)){
+    twophase_save_tables(opts->tables_path);
+  }
+  twophase_init();
+  reduce_init();
+  if(opts->lock_tables){
+    twophase_lock_tables();
+  }
+  fprintf(stderr, "Tables ready in %.3fs\n", get_time() - start);
+
+  pthread_mutex_init(&server->lock, NULL);
+  pthread_cond_init(&server->queued, NULL);
+  pthread_cond_init(&server->finished, NULL);
+
+  pthread_t *workers = Calloc(server->workers, sizeof(pthread_t));
+  for(int i = 0; i < server->workers; i++){
+    if(pthread_create(&workers[i], NULL, worker_thread, server) != 0){
+      quit("Error: Could not start a thread!\n");
+    }
+  }
+  fprintf(stderr, "Listening on %s with %d workers\n",
+          opts->socket_path, server->workers);
+
+  while(true){
+    int fd = accept(server->listen_fd, NULL, NULL);
+    if(fd < 0){
+      pthread_mutex_lock(&server->lock);
+      bool stopping = server->stopping;
+      pthread_mutex_unlock(&server->lock);
+      if(stopping){
+        break;
+      }
+      if(errno == EINTR || errno == ECONNABORTED){
+        continue;
+      }
+      fprintf(stderr, "Could not accept a connection\n");
+      break;
+    }
+
+    connection_t *c = Calloc(1, sizeof(connection_t));
+    c->server = server;
+    c->fd = fd;
+    pthread_t thread;
+    if(pthread_create(&thread, NULL, connection_thread, c) != 0){
+      quit("Error: Could not start a thread!\n");
+    }
+    pthread_detach(thread);
+  }
+
+  //Finish and answer everything already taken in
+  pthread_mutex_lock(&server->lock);
+  server->stopping = true;
+  pthread_cond_broadcast(&server->queued);
+  pthread_mutex_unlock(&server->lock);
+  for(int i = 0; i < server->workers; i++){
+    pthread_join(workers[i], NULL);
+  }
+  pthread_mutex_lock(&server->lock);
+  while(server->in_flight > 0){
+    pthread_cond_wait(&server->finished, &server->lock);
+  }
+  pthread_mutex_unlock(&server->lock);
+
+  char *report = latency_report(server);
+  fprintf(stderr, "%s\n", report);
+  free(report);
+
+  close(server->listen_fd);
+  unlink(opts->socket_path);
+  free(workers);
+
+  //Connection threads may still be waiting on idle clients, so the server
+  //itself is left for the process to clean up
+  return 0;
+}
+
+int connect_server(const char *path){
+  struct sockaddr_un addr;
+  if(strlen(path) >= sizeof(addr.sun_path)){
+    return -1;
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(fd < 0){
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  if(connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0){
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+bool send_message(int fd, const char *text, size_t len){
+  if(len > MAX_MESSAGE_LEN){
+    return false;
+  }
+
+  unsigned char header[4] = {
+    (len >> 24) & 0xFF, (len >> 16) & 0xFF, (len >> 8) & 0xFF, len & 0xFF
+  };
+  return write_all(fd, header, sizeof(header)) && write_all(fd, text, len);
+}
+
+char *recv_message(int fd){
+  unsigned char header[4];
+  if(!read_all(fd, header, sizeof(header))){
+    return NULL;
+  }
+
+  size_t len = ((size_t) header[0] << 24) | ((size_t) header[1] << 16)
+    | ((size_t) header[2] << 8) | header[3];
+  if(len > MAX_MESSAGE_LEN){
+    return NULL;
+  }
+
+  char *ret = Calloc(len + 1, sizeof(char));
+  if(!read_all(fd, ret, len)){
+    free(ret);
+    return NULL;
+  }
+
+  return ret;
+}
+
+/********************
+ * HELPER FUNCTIONS *
+ ********************/
+
+bool read_all(int fd, void *buf, size_t len){
+  size_t done = 0;
+  while(done < len){
+    ssize_t got = read(fd, (char *) buf + done, len - done);
+    if(got < 0 && errno == EINTR){
+      continue;
+    }
+    if(got <= 0){
+      return false;
+    }
+    done += got;
+  }
+
+  return true;
+}
+
+bool write_all(int fd, const void *buf, size_t len){
+  size_t done = 0;
+  while(done < len){
+    //A client that hung up should not take the server down with SIGPIPE
+    ssize_t sent = send(fd, (const char *) buf + done, len - done,
+                        MSG_NOSIGNAL);
+    if(sent < 0 && errno == EINTR){
+      continue;
+    }
+    if(sent <= 0){
+      return false;
+    }
+    done += sent;
+  }
+
+  return true;
+}
+
+int listen_at(const char *path){
+  struct sockaddr_un addr;
+  if(strlen(path) >= sizeof(addr.sun_path)){
+    fprintf(stderr, "Socket path too long: %s\n", path);
+    return -1;
+  }
+
+  //Only replace a socket nothing is listening on any more
+  int existing = connect_server(path);
+  if(existing >= 0){
+    close(existing);
+    fprintf(stderr, "A server is already listening on %s\n", path);
+    return -1;
+  }
+  unlink(path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  if(fd < 0 || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0
+     || listen(fd, SOMAXCONN) != 0){
+    fprintf(stderr, "Could not listen on %s\n", path);
+    if(fd >= 0){
+      close(fd);
+    }
+    return -1;
+  }
+
+  return fd;
+}
+
+void *connection_thread(void *arg){
+  connection_t *c = arg;
+  server_t *server = c->server;
+  char *request;
+
+  while((request = recv_message(c->fd)) != NULL){
+    double start = get_time();
+    int command = command_of(request);
+    char *response = NULL;
+
+    //Shutting down is answered here, so the answer gets out before exiting
+    if(is_shutdown(request)){
+      response = respond(true, "shutting down");
+      send_message(c->fd, response, strlen(response));
+      free(response);
+      free(request);
+
+      pthread_mutex_lock(&server->lock);
+      server->stopping = true;
+      pthread_mutex_unlock(&server->lock);
+      shutdown(server->listen_fd, SHUT_RDWR);
+      break;
+    }
+
+    job_t *job = Calloc(1, sizeof(job_t));
+    job->request = request;
+
+    pthread_mutex_lock(&server->lock);
+    bool queued = !server->stopping;
+    if(!queued){
+      response = respond(false, "the server is shutting down");
+    }
+    else{
+      if(server->tail != NULL){
+        server->tail->next = job;
+      }
+      else{
+        server->head = job;
+      }
+      server->tail = job;
+      server->queue_len++;
+      server->in_flight++;
+      pthread_cond_signal(&server->queued);
+
+      while(!job->done){
+        pthread_cond_wait(&server->finished, &server->lock);
+      }
+      response = job->response;
+    }
+
+    latency_t *l = &server->latencies[command];
+    l->samples[l->count % MAX_SAMPLES] = get_time() - start;
+    l->count++;
+    pthread_mutex_unlock(&server->lock);
+
+    send_message(c->fd, response, strlen(response));
+    free(response);
+    free(job->request);
+    free(job);
+
+    if(queued){
+      pthread_mutex_lock(&server->lock);
+      server->in_flight--;
+      pthread_cond_broadcast(&server->finished);
+      pthread_mutex_unlock(&server->lock);
+    }
+  }
+
+  close(c->fd);
+  free(c);
+  return NULL;
+}
+
+void *worker_thread(void *arg){
+  server_t *server = arg;
+
+  while(true){
+    pthread_mutex_lock(&server->lock);
+    while(server->head == NULL && !server->stopping){
+      pthread_cond_wait(&server->queued, &server->lock);
+    }
+    if(server->head == NULL){
+      pthread_mutex_unlock(&server->lock);
+      break;
+    }
+
+    //Only batch up once there is more waiting than the workers can share
+    int size = MAX(1, MIN(MAX_BATCH, server->queue_len / server->workers));
+    job_t *batch = server->head;
+    job_t *last = batch;
+    for(int i = 1; i < size; i++){
+      last = last->next;
+    }
+    server->head = last->next;
+    if(server->head == NULL){
+      server->tail = NULL;
+    }
+    last->next = NULL;
+    server->queue_len -= size;
+    server->batches++;
+    server->batched_jobs += size;
+    pthread_mutex_unlock(&server->lock);
+
+    for(job_t *j = batch; j != NULL; j = j->next){
+      j->response = handle_request(server, j->request);
+    }
+
+    //Once done is set the job belongs to its connection again
+    pthread_mutex_lock(&server->lock);
+    job_t *j = batch;
+    while(j != NULL){
+      job_t *next = j->next;
+      j->done = true;
+      j = next;
+    }
+    pthread_cond_broadcast(&server->finished);
+    pthread_mutex_unlock(&server->lock);
+  }
+
+  return NULL;
+}
+
+int command_of(const char *request){
+  char word[MAX_COMMAND_LEN] = "";
+  sscanf(request, "%15s", word);
+  for(int i = 0; i < CMD_OTHER; i++){
+    if(strcmp(word, COMMAND_NAMES[i]) == 0){
+      return i;
+    }
+  }
+
+  return CMD_OTHER;
+}
+
+bool is_shutdown(const char *request){
+  char word[MAX_COMMAND_LEN] = "";
+  int end = 0;
+  if(sscanf(request, "%15s%n", word, &end) != 1
+     || strcmp(word, "shutdown") != 0){
+    return false;
+  }
+
+  //Anything after the word is a mistake, not a reason to stop the server
+  for(int i = end; request[i] != '\0'; i++){
+    if(!isspace(request[i])){
+      return false;
+    }
+  }
+  return true;
+}
+
+char *respond(bool ok, const char *format, ...){
+  const char *prefix = ok ? "ok " : "error ";
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+
+  char *ret = Calloc(strlen(prefix) + len + 1, sizeof(char));
+  strcpy(ret, prefix);
+  va_start(args, format);
+  vsnprintf(ret + strlen(prefix), len + 1, format, args);
+  va_end(args);
+
+  return ret;
+}
+
+char *handle_request(server_t *server, const char *request){
+  int command = command_of(request);
+  if(command == CMD_OTHER){
+    char word[MAX_COMMAND_LEN] = "";
+    sscanf(request, "%15s", word);
+    if(strcmp(word, "stats") == 0){
+      char *report = latency_report(server);
+      char *ret = respond(true, "%s", report);
+      free(report);
+      return ret;
+    }
+    if(strcmp(word, "shutdown") == 0){
+      return respond(false, "shutdown takes no arguments");
+    }
+    return respond(false, "unknown command: %s", word);
+  }
+
+  int side_len;
+  const char *rest;
+  if(!parse_size(request, &side_len, &rest)){
+    return respond(false, "expected a size from 1 to %d", MAX_SERVE_SIZE);
+  }
+
+  switch(command){
+  case CMD_SOLVE:
+    return handle_solve(side_len, rest);
+  case CMD_APPLY:
+    return handle_apply(side_len, rest);
+  case CMD_ORDER:
+    return handle_order(side_len, rest);
+  default:
+    return handle_verify(side_len, rest);
+  }
+}
+
+bool parse_size(const char *request, int *side_len, const char **rest){
+  int end = 0;
+  char word[MAX_COMMAND_LEN];
+  if(sscanf(request, "%15s %d%n", word, side_len, &end) < 2
+     || *side_len < 1 || *side_len > MAX_SERVE_SIZE){
+    return false;
+  }
+
+  *rest = request + end;
+  return true;
+}
+
+char *handle_solve(int side_len, const char *rest){
+  color *stickers = Calloc(NUM_FACES * side_len * side_len, sizeof(color));
+  if(!parse_state(rest, side_len, stickers)){
+    free(stickers);
+    return respond(false, "invalid state");
+  }
+
+  state_t *s = state_import(side_len, stickers);
+  alg_t *solution = side_len == 3
+    ? twophase_solve(s, NULL, NULL)
+    : reduce_solve(s, NULL, NULL);
+  free_state(s);
+  free(stickers);
+  if(solution == NULL){
+    return respond(false, "no solution found");
+  }
+
+  char *str = alg_to_string(solution);
+  char *ret = respond(true, "%s", str);
+  free(str);
+  free_alg(solution);
+  return ret;
+}
+
+char *handle_apply(int side_len, const char *rest){
+  alg_t *a = parse_alg(side_len, rest);
+  if(a == NULL){
+    return respond(false, "invalid algorithm");
+  }
+
+  state_t *s = new_state(side_len);
+  for(int i = 0; i < a->len; i++){
+    apply_move(s, a->moves[i]);
+  }
+
+  //The state as write_state prints it, on one line
+  char *text = NULL;
+  size_t len = 0;
+  FILE *f = open_memstream(&text, &len);
+  write_state(f, s);
+  fclose(f);
+  int out = 0;
+  for(size_t i = 0; i < len; i++){
+    if(text[i] != '\n'){
+      text[out] = text[i];
+      out++;
+    }
+  }
+  text[out] = '\0';
+
+  char *ret = respond(true, "%s", text);
+  free(text);
+  free_state(s);
+  free_alg(a);
+  return ret;
+}
+
+char *handle_order(int side_len, const char *rest){
+  alg_t *a = parse_alg(side_len, rest);
+  if(a == NULL){
+    return respond(false, "invalid algorithm");
+  }
+
+  perm_t *p = compile_alg(a);
+  long order = perm_order(p);
+  free_perm(p);
+  free_alg(a);
+  if(order < 0){
+    return respond(false, "the order is too large");
+  }
+
+  return respond(true, "%ld", order);
+}
+
+char *handle_verify(int side_len, const char *rest){
+  const char *bar = strchr(rest, '|');
+  if(bar == NULL){
+    return respond(false, "expected a state and an algorithm split by '|'");
+  }
+
+  char *state_text = Calloc(bar - rest + 1, sizeof(char));
+  memcpy(state_text, rest, bar - rest);
+  color *stickers = Calloc(NUM_FACES * side_len * side_len, sizeof(color));
+  bool ok = parse_state(state_text, side_len, stickers);
+  free(state_text);
+  alg_t *a = parse_alg(side_len, bar + 1);
+  if(!ok || a == NULL){
+    free(stickers);
+    free_alg(a);
+    return respond(false, ok ? "invalid algorithm" : "invalid state");
+  }
+
+  state_t *s = state_import(side_len, stickers);
+  for(int i = 0; i < a->len; i++){
+    apply_move(s, a->moves[i]);
+  }
+  state_t *solved = new_state(side_len);
+  bool is_solved = state_equal(s, solved);
+
+  free_state(solved);
+  free_state(s);
+  free_alg(a);
+  free(stickers);
+  return respond(true, is_solved ? "solved" : "unsolved");
+}
+
+char *latency_report(server_t *server){
+  char *text = NULL;
+  size_t len = 0;
+  FILE *f = open_memstream(&text, &len);
+  double *sorted = Calloc(MAX_SAMPLES, sizeof(double));
+
+  pthread_mutex_lock(&server->lock);
+  long total = 0;
+  for(int i = 0; i < NUM_COMMANDS; i++){
+    total += server->latencies[i].count;
+  }
+  fprintf(f, "%ld requests", total);
+  for(int i = 0; i < NUM_COMMANDS; i++){
+    latency_t *l = &server->latencies[i];
+    if(l->count == 0){
+      continue;
+    }
+
+    int n = MIN(l->count, MAX_SAMPLES);
+    memcpy(sorted, l->samples, n * sizeof(double));
+    qsort(sorted, n, sizeof(double), compare_doubles);
+    fprintf(f, "\n%-7s %8ld requests  p50 %.3fms  p90 %.3fms  p99 %.3fms"
+            "  max %.3fms", COMMAND_NAMES[i], l->count,
+            sorted[n / 2] * 1000, sorted[n * 9 / 10] * 1000,
+            sorted[n * 99 / 100] * 1000, sorted[n - 1] * 1000);
+  }
+  if(server->batches > 0){
+    fprintf(f, "\n%ld batches of %.2f requests on average", server->batches,
+            (double) server->batched_jobs / server->batches);
+  }
+  pthread_mutex_unlock(&server->lock);
+
+  fclose(f);
+  free(sorted);
+  return text;
+}
+
+int compare_doubles(const void *a, const void *b){
+  double x = *(const double *) a;
+  double y = *(const double *) b;
+  return (x > y) - (x < y);
+}
@@ -0,0 +1,63 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define DEFAULT_SOCKET_PATH "/tmp/cube_sim.sock"
+
+/* The longest message either side will accept.
+ */
+#define MAX_MESSAGE_LEN (1 << 20)
+
+/* Requests and responses are messages: a 4 byte big endian length followed
+ * by that many bytes of text. A request is a command, usually followed by the
+ * size of the cube and its arguments:
+ *
+ *   solve <size> <state>           A solution to the state.
+ *   apply <size> <alg>             The stickers after alg, as color letters.
+ *   order <size> <alg>             How many times alg must be repeated to get
+ *                                  back to where it started.
+ *   verify <size> <state> | <alg>  "solved" if alg solves the state and
+ *                                  "unsolved" if it doesn't.
+ *   stats                          Latency percentiles of each command.
+ *   shutdown                       Stops the server.
+ *
+ * A state is written either as every sticker's color letter or as a scramble,
+ * the same as a line of a states file for verify. Every response starts with
+ * "ok " or "error " followed by the answer or what went wrong.
+ */
+
+/* How to run the server. tables_path, if set, is where the solver tables are
+ * loaded from, or saved to if they are not there yet. lock_tables keeps them
+ * from ever being paged out.
+ */
+typedef struct serve_options_t{
+  const char *socket_path;
+  const char *tables_path;
+  bool lock_tables;
+  int workers;
+} serve_options_t;
+
+/* Loads the solver's tables and answers requests on the socket until one
+ * asks it to shut down. Requests from every connection go into one queue,
+ * which the workers take from in batches. Returns the exit status for the
+ * program.
+ */
+int serve(const serve_options_t *opts);
+
+/* Returns a socket connected to the server at path, or -1 if there is none.
+ */
+int connect_server(const char *path);
+
+/* Sends len bytes of text as one message. Returns false if the connection
+ * failed.
+ */
+bool send_message(int fd, const char *text, size_t len);
+
+/* Returns the text of the next message on fd with a terminator added, or NULL
+ * if the connection closed or the message was too long.
+ */
+char *recv_message(int fd);
+
+#endif
@@ -0,0 +1,289 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "alg.h"
+#include "helpers.h"
+#include "perm.h"
+#include "shuffle.h"
+
+#define NUM_FACES 6
+#define LANE 16
+#define NUM_LANES (SHUFFLE_BLOCK / LANE)
+#define NUM_SHUFFLE_MOVES (NUM_FACES * MAX_SHUFFLE_SIZE * 3)
+
+//The vector engines need GCC's per-function targets and x86 intrinsics
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHUFFLE_X86
+#include <immintrin.h>
+#endif
+
+/* The shuffles for one size of cube, indexed by move_index.
+ */
+typedef struct shuffle_table_t{
+  int stickers;               //How many bytes of the block are stickers
+  int lanes;                  //How many 16 byte lanes those bytes cover
+
+  //Each byte of the result comes from byte src[i] of the block
+  uint8_t src[NUM_SHUFFLE_MOVES][SHUFFLE_BLOCK];
+
+  /* pshufb only shuffles within a 16 byte lane, so each lane of the result
+   * is put together from one shuffle of every lane of the block. Bytes that
+   * come from a different lane have their top bit set, which pshufb turns
+   * into zero.
+   */
+  uint8_t masks[NUM_SHUFFLE_MOVES][NUM_LANES][NUM_LANES][LANE];
+} shuffle_table_t;
+
+typedef void (*shuffle_fn_t)(color *block, const shuffle_table_t *t, int move);
+
+static shuffle_table_t tables[MAX_SHUFFLE_SIZE + 1];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+static int engine = SHUFFLE_SCALAR;
+static shuffle_fn_t engine_turn;
+
+/******************************
+ * HELPER FUNCTION PROTOTYPES *
+ ******************************/
+
+/* Builds the tables and picks an engine. Only called through pthread_once.
+ */
+void build_shuffles();
+
+/* Fills in the shuffles for the given size of cube.
+ */
+void build_table(shuffle_table_t *t, int side_len);
+
+/* Returns the row of the tables used for the given move, which must be
+ * valid.
+ */
+int move_index(move_t m);
+
+/* The engines, each turning block by the given row of t.
+ */
+void shuffle_scalar(color *block, const shuffle_table_t *t, int move);
+#ifdef SHUFFLE_X86
+/* The body of shuffle_pshufb, inlined with lanes a constant for each size so
+ * the loops unroll.
+ */
+static inline void pshufb_lanes(color *block,
+                                const shuffle_table_t *t,
+                                int move,
+                                int lanes);
+void shuffle_pshufb(color *block, const shuffle_table_t *t, int move);
+void shuffle_vpermb(color *block, const shuffle_table_t *t, int move);
+#endif
+
+/* Returns the function for the given engine.
+ */
+shuffle_fn_t engine_fn(int which);
+
+/****************************
+ * FUNCTION IMPLEMENTATIONS *
+ ****************************/
+
+void shuffle_init(){
+  pthread_once(&tables_once, build_shuffles);
+}
+
+bool shuffle_supported(int side_len){
+  return side_len >= 2 && side_len <= MAX_SHUFFLE_SIZE;
+}
+
+bool shuffle_engine_supported(int which){
+#ifdef SHUFFLE_X86
+  if(which == SHUFFLE_PSHUFB){
+    return __builtin_cpu_supports("ssse3");
+  }
+  if(which == SHUFFLE_VPERMB){
+    return __builtin_cpu_supports("avx512vbmi");
+  }
+#endif
+  return which == SHUFFLE_SCALAR;
+}
+
+const char *shuffle_engine_name(int which){
+  switch(which){
+  case SHUFFLE_PSHUFB:
+    return "pshufb";
+  case SHUFFLE_VPERMB:
+    return "vpermb";
+  default:
+    return "scalar";
+  }
+}
+
+int shuffle_current_engine(){
+  shuffle_init();
+  return engine;
+}
+
+bool shuffle_use_engine(int which){
+  shuffle_init();
+  if(which < 0 || which >= NUM_SHUFFLE_ENGINES
+     || !shuffle_engine_supported(which)){
+    return false;
+  }
+
+  engine = which;
+  engine_turn = engine_fn(which);
+  return true;
+}
+
+bool shuffle_load(shuffle_cube_t *c, state_t *s){
+  if(c == NULL || !shuffle_supported(state_side_len(s))){
+    return false;
+  }
+
+  shuffle_init();
+  memset(c->stickers, 0, SHUFFLE_BLOCK);
+  state_export(s, c->stickers);
+  c->side_len = state_side_len(s);
+  return true;
+}
+
+state_t *shuffle_store(const shuffle_cube_t *c){
+  return state_import(c->side_len, c->stickers);
+}
+
+void shuffle_move(shuffle_cube_t *c, move_t m){
+  if(m.face < 0 || m.face >= NUM_FACES
+     || m.depth < 0 || m.depth >= c->side_len){
+    return;
+  }
+
+  m.turns = ((m.turns % 4) + 4) % 4;
+  if(m.turns == 0){
+    return;
+  }
+
+  engine_turn(c->stickers, &tables[c->side_len], move_index(m));
+}
+
+/********************
+ * HELPER FUNCTIONS *
+ ********************/
+
+void build_shuffles(){
+  for(int n = 2; n <= MAX_SHUFFLE_SIZE; n++){
+    build_table(&tables[n], n);
+  }
+
+  //Take the fastest engine there is
+  for(int i = NUM_SHUFFLE_ENGINES - 1; i >= 0; i--){
+    if(shuffle_engine_supported(i)){
+      engine = i;
+      break;
+    }
+  }
+  engine_turn = engine_fn(engine);
+}
+
+void build_table(shuffle_table_t *t, int side_len){
+  t->stickers = NUM_FACES * side_len * side_len;
+  t->lanes = (t->stickers + LANE - 1) / LANE;
+
+  for(int face = 0; face < NUM_FACES; face++){
+    for(int depth = 0; depth < side_len; depth++){
+      for(int turns = 1; turns <= 3; turns++){
+        move_t m = {face, depth, turns};
+        int row = move_index(m);
+
+        //Compiling the move keeps the shuffle exactly what apply_move does
+        alg_t *a = new_alg(side_len);
+        alg_append(a, m);
+        perm_t *p = compile_alg(a);
+
+        //The unused end of the block stays where it is
+        for(int i = 0; i < SHUFFLE_BLOCK; i++){
+          t->src[row][i] = i < t->stickers ? p->src[i] : i;
+        }
+
+        for(int out = 0; out < NUM_LANES; out++){
+          for(int in = 0; in < NUM_LANES; in++){
+            for(int b = 0; b < LANE; b++){
+              int from = t->src[row][out * LANE + b];
+              t->masks[row][out][in][b] = from / LANE == in
+                ? from % LANE
+                : 0x80;
+            }
+          }
+        }
+
+        free_perm(p);
+        free_alg(a);
+      }
+    }
+  }
+}
+
+int move_index(move_t m){
+  return (m.face * MAX_SHUFFLE_SIZE + m.depth) * 3 + m.turns - 1;
+}
+
+void shuffle_scalar(color *block, const shuffle_table_t *t, int move){
+  color old[SHUFFLE_BLOCK];
+  memcpy(old, block, t->stickers);
+
+  const uint8_t *src = t->src[move];
+  for(int i = 0; i < t->stickers; i++){
+    block[i] = old[src[i]];
+  }
+}
+
+#ifdef SHUFFLE_X86
+__attribute__((target("ssse3")))
+static inline void pshufb_lanes(color *block,
+                                const shuffle_table_t *t,
+                                int move,
+                                int lanes){
+  __m128i in[NUM_LANES];
+  for(int i = 0; i < lanes; i++){
+    in[i] = _mm_loadu_si128((const __m128i *) (block + i * LANE));
+  }
+
+#pragma GCC unroll 4
+  for(int out = 0; out < lanes; out++){
+    __m128i result = _mm_setzero_si128();
+#pragma GCC unroll 4
+    for(int i = 0; i < lanes; i++){
+      __m128i mask = _mm_loadu_si128(
+        (const __m128i *) t->masks[move][out][i]);
+      result = _mm_or_si128(result, _mm_shuffle_epi8(in[i], mask));
+    }
+    _mm_storeu_si128((__m128i *) (block + out * LANE), result);
+  }
+}
+
+__attribute__((target("ssse3")))
+void shuffle_pshufb(color *block, const shuffle_table_t *t, int move){
+  //A 2x2 fits in two lanes and a 3x3 in all four
+  if(t->lanes == 2){
+    pshufb_lanes(block, t, move, 2);
+  }
+  else{
+    pshufb_lanes(block, t, move, NUM_LANES);
+  }
+}
+
+__attribute__((target("avx512vbmi")))
+void shuffle_vpermb(color *block, const shuffle_table_t *t, int move){
+  //The whole block is one register, so a turn is a single vpermb
+  __m512i stickers = _mm512_loadu_si512(block);
+  __m512i src = _mm512_loadu_si512(t->src[move]);
+  _mm512_storeu_si512(block, _mm512_permutexvar_epi8(src, stickers));
+}
+#endif
+
+shuffle_fn_t engine_fn(int which){
+#ifdef SHUFFLE_X86
+  if(which == SHUFFLE_VPERMB){
+    return shuffle_vpermb;
+  }
+  if(which == SHUFFLE_PSHUFB){
+    return shuffle_pshufb;
+  }
+#endif
+  return shuffle_scalar;
+}
@@ -0,0 +1,78 @@
+#ifndef SHUFFLE_H
+#define SHUFFLE_H
+
+#include <stdbool.h>
+#include "state.h"
+
+/* Every sticker of a 2x2 or 3x3 fits in one block of this many bytes.
+ */
+#define SHUFFLE_BLOCK 64
+#define MAX_SHUFFLE_SIZE 3
+
+/* The ways a turn can be made, slowest first. The vector ones are only
+ * available on processors that support them.
+ */
+#define SHUFFLE_SCALAR 0
+#define SHUFFLE_PSHUFB 1
+#define SHUFFLE_VPERMB 2
+#define NUM_SHUFFLE_ENGINES 3
+
+#ifdef __GNUC__
+#define SHUFFLE_ALIGN __attribute__((aligned(SHUFFLE_BLOCK)))
+#else
+#define SHUFFLE_ALIGN
+#endif
+
+/* A small cube kept as one block of stickers, laid out the way state_export
+ * writes them with the rest of the block unused. Each turn is a single
+ * precomputed shuffle of the whole block, so it can stay in registers.
+ */
+typedef struct shuffle_cube_t{
+  color stickers[SHUFFLE_BLOCK] SHUFFLE_ALIGN;
+  int side_len;
+} shuffle_cube_t;
+
+/* Builds the shuffle for every turn and picks the fastest engine this
+ * processor supports. Only the first call does any work, and shuffle_load
+ * calls it itself.
+ */
+void shuffle_init();
+
+/* Returns true if cubes of the given size can be loaded.
+ */
+bool shuffle_supported(int side_len);
+
+/* Returns true if this processor can run the given engine.
+ */
+bool shuffle_engine_supported(int engine);
+
+/* Returns the name of the given engine, like "pshufb".
+ */
+const char *shuffle_engine_name(int engine);
+
+/* Returns the engine every turn is currently made with.
+ */
+int shuffle_current_engine();
+
+/* Makes every turn from now on use the given engine, mostly so they can be
+ * compared. This affects every cube and is not safe while other threads are
+ * turning them. Returns false, leaving the engine alone, if it is not
+ * supported.
+ */
+bool shuffle_use_engine(int engine);
+
+/* Copies the stickers of s into c. Returns false if s is not a size that
+ * shuffle_supported allows.
+ */
+bool shuffle_load(shuffle_cube_t *c, state_t *s);
+
+/* Returns a new state with the stickers of c.
+ */
+state_t *shuffle_store(const shuffle_cube_t *c);
+
+/* Makes the move m on c, leaving the same stickers apply_move would. An
+ * invalid move does nothing.
+ */
+void shuffle_move(shuffle_cube_t *c, move_t m);
+
+#endif
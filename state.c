@@ -1,4 +1,6 @@
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -8,10 +10,62 @@
 #include "helpers.h"
 
 #define NUM_FACES 6
+#define NUM_SIDES 4
+#define COLOR_LETTERS "BOWRYG"
+
+/* The sizes that get a move kernel of their own. Anything else is turned by
+ * the generic code.
+ */
+#define MIN_KERNEL_SIZE 2
+#define MAX_KERNEL_SIZE 7
+
+/* Packed states keep 21 three bit stickers in each word, and start every row
+ * of a face on a new word so that rows can be copied a word at a time. Bits
+ * past the end of a row are always zero.
+ */
+#define STICKER_BITS 3
+#define STICKER_MASK 7
+#define STICKERS_PER_WORD 21
+
+/* A packed row takes a whole word, eight bytes, for up to 21 stickers, so
+ * packing only saves memory once a row has more than eight stickers.
+ */
+#define MIN_PACKED_SIZE 9
+
+/* The strips around each face that a turn moves, as a face and the side of
+ * that face which touches the turning face. A clockwise turn moves each strip
+ * into the place of the one before it, exactly as in make_move.
+ */
+static const int RING[NUM_FACES][NUM_SIDES][2] = {
+  {{1, 0}, {2, 0}, {3, 0}, {4, 0}},
+  {{0, 3}, {4, 1}, {5, 3}, {2, 3}},
+  {{0, 2}, {1, 1}, {5, 0}, {3, 3}},
+  {{0, 1}, {2, 1}, {5, 1}, {4, 3}},
+  {{0, 0}, {3, 1}, {5, 2}, {1, 3}},
+  {{1, 2}, {4, 2}, {3, 2}, {2, 2}}
+};
+
+/* Makes turns clockwise quarter turns, from 1 to 3, of the slice depth layers
+ * in from the given face. The arguments are assumed to be valid.
+ */
+typedef void (*move_kernel_t)(color **faces, int face, int depth, int turns);
+
+/* Faces are allocated with a count of the states using them in front, so
+ * that a copy of a state can share every face until one of them changes it.
+ * The count is changed atomically, since copies are handed between threads.
+ */
+typedef struct block_t{
+  int refs;
+  uint64_t data[];
+} block_t;
 
 struct state_t{
   int side_len;
-  color **faces;
+  color **faces;              //NULL if the state is packed
+  uint64_t **packed;          //Each face row by row, NULL unless packed
+  int row_words;              //Words in each row of a packed face
+  uint64_t *scratch;          //A packed face to rotate a face into, or NULL
+  move_kernel_t kernel;       //NULL if this size uses the generic code
 };
 
 
@@ -37,16 +91,107 @@ struct state_t{
  */
 void rotate_face(color *face, int side_len);
 
-/* Copies the given side from source over the given side of dest. Depth is used
- * to determine which whether the outermost layer should be used, or a layer 
- * closer to the center.
+/* Returns a new face of the given size, zeroed and used by one state.
+ */
+void *new_block(size_t bytes);
+
+/* Adds a state to the users of a face and returns it.
+ */
+void *share_block(void *data);
+
+/* Removes a state from the users of a face, freeing it if that was the last.
+ * data may be NULL.
+ */
+void release_block(void *data);
+
+/* Returns data if the calling state is its only user, and otherwise a copy of
+ * it that is, releasing data.
+ */
+void *own_block(void *data, size_t bytes);
+
+/* Returns the stickers of the given face, whether or not s is packed.
+ */
+static inline void *face_data(state_t *s, int face);
+
+/* Gives s a face of its own for every face turning the given slice changes,
+ * so that a move never changes a face another state can see.
+ */
+void own_faces(state_t *s, int face, int depth);
+
+/* Returns a new state with a single quarter turn of the given face made on s.
+ * An invalid face or depth returns an unchanged copy.
+ */
+state_t *turn_slice(state_t *s, int face, int depth, bool clockwise);
+
+/* Copies the strip depth layers in from source_side of source over the one
+ * depth layers in from dest_side of dest. The faces must be different.
+ */
+void move_strip(color *dest,
+                int dest_side,
+                color *source,
+                int source_side,
+                int side_len,
+                int depth);
+
+/* Returns the kernel specialized for the given size, or NULL if there is
+ * none.
+ */
+move_kernel_t kernel_for(int side_len);
+
+/* Sets *start to the index of the first sticker of a strip, as strip_coord
+ * numbers them, and *stride to how far apart its stickers are.
+ */
+static inline void strip_layout(int side,
+                                int depth,
+                                int side_len,
+                                int *start,
+                                int *stride);
+
+/* The body of every specialized kernel. Each one inlines this once for every
+ * face, with side_len and face constants, so the loops have fixed trip
+ * counts the compiler can unroll, and the faces, starts and strides of the
+ * strips come out of RING and strip_layout as constants. Only the depth of
+ * the slice is left to add at run time.
  */
-void copy_side(color *dest,
-               int dest_side,
-               color *source,
-               int source_side,
-               int side_len,
-	       int depth);
+static inline void turn_kernel(color **faces,
+                               int side_len,
+                               int face,
+                               int depth,
+                               int turns);
+
+/* Returns the words of the given row of a face of a packed state.
+ */
+static inline uint64_t *packed_row(state_t *s, int face, int y);
+
+/* Returns a sticker of a face, by its index into the face, whether or not s
+ * is packed.
+ */
+static inline color get_sticker(state_t *s, int face, int index);
+
+/* Returns the sticker x along a packed row.
+ */
+static inline color packed_at(const uint64_t *row, int x);
+
+/* Copies the given row of a face to or from out, which has room for a row.
+ * Packed rows are unpacked and packed a word at a time.
+ */
+void read_row(state_t *s, int face, int y, color *out);
+void write_row(state_t *s, int face, int y, const color *in);
+
+/* Copies the strip depth layers in from the given side of a face to or from
+ * buf, in the order strip_coord numbers it. Strips along rows go through
+ * read_row and write_row. Strips along columns are at the same word and bit
+ * of every row, so they are found once and then stepped a row at a time.
+ */
+void read_strip(state_t *s, int face, int side, int depth, color *buf);
+void write_strip(state_t *s, int face, int side, int depth, const color *buf);
+
+/* Makes the move m on a packed state. A turning face is rotated into the
+ * state's scratch face, which then trades places with it. Rows that move to
+ * the same row of another face are copied word by word; everything else goes
+ * through read_strip and write_strip.
+ */
+void packed_move(state_t *s, move_t m);
 
 /* Returns the first letter of the given color.
  */
@@ -71,6 +216,12 @@ int get_depth(char *str);
  */
 bool is_clockwise(char *str);
 
+/* Returns 2 if the face in the command is followed by a "2", like "U2" or
+ * "2U2'", indicating a half turn, and 1 otherwise. str must be a valid,
+ * NULL-Terminated string.
+ */
+int get_turns(char *str);
+
 /**************************** 
  * FUNCTION IMPLEMENTATIONS *
  ****************************/
@@ -83,17 +234,14 @@ state_t *new_state(int side_len){
   
   state_t *ret = Calloc(1, sizeof(state_t));
   ret->side_len = side_len;
+  ret->kernel = kernel_for(side_len);
   
   //Allocate our array of sides
   ret->faces = Calloc(NUM_FACES, sizeof(color *));
 
   //Allocate each side
   for(int i = 0; i < NUM_FACES; i++){
-    ret->faces[i] = malloc(side_len * side_len * sizeof(color));
-    if(ret->faces[i] == NULL){
-      quit("Error! Out of memory!\n");
-    }
-    
+    ret->faces[i] = new_block(side_len * side_len * sizeof(color));
     memset(ret->faces[i], i, side_len * side_len);
   }
 
@@ -106,25 +254,107 @@ void free_state(state_t *s){
   }
 
   for(int i = 0; i < NUM_FACES; i++){
-    if(s->faces[i] != NULL){
-      free(s->faces[i]);
+    if(s->faces != NULL){
+      release_block(s->faces[i]);
+    }
+    if(s->packed != NULL){
+      release_block(s->packed[i]);
     }
   }
+  release_block(s->scratch);
   free(s->faces);
+  free(s->packed);
   free(s);
 }
 
 state_t *copy_state(state_t *s){
-  state_t *copy = new_state(s->side_len);
+  state_t *copy = Calloc(1, sizeof(state_t));
+  copy->side_len = s->side_len;
+  copy->row_words = s->row_words;
+  copy->kernel = s->kernel;
 
-  for(int i = 0; i < NUM_FACES; i++){
-    memcpy(copy->faces[i], s->faces[i], s->side_len * s->side_len);
+  //Every face is shared until one of the two states turns it
+  if(s->packed != NULL){
+    copy->packed = Calloc(NUM_FACES, sizeof(uint64_t *));
+    for(int i = 0; i < NUM_FACES; i++){
+      copy->packed[i] = share_block(s->packed[i]);
+    }
+  }
+  else{
+    copy->faces = Calloc(NUM_FACES, sizeof(color *));
+    for(int i = 0; i < NUM_FACES; i++){
+      copy->faces[i] = share_block(s->faces[i]);
+    }
   }
 
   return copy;
 }
 
 state_t *make_move(state_t *s, char *input){
+  //Parse the input
+  int face = get_face(input);
+  int depth = get_depth(input);
+  bool clockwise = is_clockwise(input);
+
+  //A half turn is just two quarter turns in the same direction
+  if(get_turns(input) == 2){
+    state_t *half = turn_slice(s, face, depth, clockwise);
+    state_t *ret = turn_slice(half, face, depth, clockwise);
+    free_state(half);
+    return ret;
+  }
+
+  return turn_slice(s, face, depth, clockwise);
+}
+
+bool parse_move(char *input, move_t *m){
+  if(input == NULL || m == NULL){
+    return false;
+  }
+
+  int face = get_face(input);
+  int depth = get_depth(input);
+  if(face < 0 || depth < 0){
+    return false;
+  }
+
+  m->face = face;
+  m->depth = depth;
+  if(get_turns(input) == 2){
+    m->turns = 2;
+  }
+  else{
+    m->turns = is_clockwise(input) ? 1 : 3;
+  }
+
+  return true;
+}
+
+void move_to_string(move_t m, char *buf){
+  if(buf == NULL){
+    return;
+  }
+
+  const char *faces = "BLURDF";
+  const char *suffix = "";
+  if(m.turns == 2){
+    suffix = "2";
+  }
+  else if(m.turns == 3){
+    suffix = "'";
+  }
+  
+  //The depth is only written out for interior slices
+  if(m.depth > 0){
+    snprintf(buf, MAX_MOVE_STR_LEN, "%d%c%s",
+             m.depth + 1, faces[m.face], suffix);
+  }
+  else{
+    snprintf(buf, MAX_MOVE_STR_LEN, "%c%s", faces[m.face], suffix);
+  }
+}
+
+state_t *turn_slice(state_t *s, int face, int depth, bool clockwise){
   //We will be returning this copy
   state_t *copy = copy_state(s);
   
@@ -133,16 +363,27 @@ state_t *make_move(state_t *s, char *input){
     return copy;
   }
 
-  //Parse the input
-  int face = get_face(input);
-  int depth = get_depth(input);
-  bool clockwise = is_clockwise(input);
-
   //Stop if the face or depth was invalid
-  if(face < 0 || depth >= s->side_len){
+  if(face < 0 || depth < 0 || depth >= s->side_len){
     return copy;
   }
-  
+
+  if(face >= NUM_FACES){
+    return copy;
+  }
+  own_faces(copy, face, depth);
+
+  if(copy->packed != NULL){
+    move_t m = {face, depth, clockwise ? 1 : 3};
+    packed_move(copy, m);
+    return copy;
+  }
+
+  if(copy->kernel != NULL){
+    copy->kernel(copy->faces, face, depth, clockwise ? 1 : 3);
+    return copy;
+  }
+
   //Rotate the side itself (don't do this if turning an interior slice)
   if(depth == 0){
     rotate_face(copy->faces[face], copy->side_len);
@@ -151,96 +392,184 @@ state_t *make_move(state_t *s, char *input){
       rotate_face(copy->faces[face], copy->side_len);
     }
   }
-  
-  //Move all the connected sides
-  switch(face){
-  case 0:
-    if(clockwise){
-      copy_side(copy->faces[1], 0, s->faces[2], 0, s->side_len, depth);
-      copy_side(copy->faces[2], 0, s->faces[3], 0, s->side_len, depth);
-      copy_side(copy->faces[3], 0, s->faces[4], 0, s->side_len, depth);
-      copy_side(copy->faces[4], 0, s->faces[1], 0, s->side_len, depth);
-    }
-    else{
-      copy_side(copy->faces[1], 0, s->faces[4], 0, s->side_len, depth);
-      copy_side(copy->faces[2], 0, s->faces[1], 0, s->side_len, depth);
-      copy_side(copy->faces[3], 0, s->faces[2], 0, s->side_len, depth);
-      copy_side(copy->faces[4], 0, s->faces[3], 0, s->side_len, depth);
-    }
-    break;
-  case 1:
-    if(clockwise){
-      copy_side(copy->faces[0], 3, s->faces[4], 1, s->side_len, depth);
-      copy_side(copy->faces[2], 3, s->faces[0], 3, s->side_len, depth);
-      copy_side(copy->faces[5], 3, s->faces[2], 3, s->side_len, depth);
-      copy_side(copy->faces[4], 1, s->faces[5], 3, s->side_len, depth);
-    }
-    else{
-      copy_side(copy->faces[0], 3, s->faces[2], 3, s->side_len, depth);
-      copy_side(copy->faces[2], 3, s->faces[5], 3, s->side_len, depth);
-      copy_side(copy->faces[5], 3, s->faces[4], 1, s->side_len, depth);
-      copy_side(copy->faces[4], 1, s->faces[0], 3, s->side_len, depth);
-    }
-    break;
-  case 2:
-    if(clockwise){
-      copy_side(copy->faces[0], 2, s->faces[1], 1, s->side_len, depth);
-      copy_side(copy->faces[3], 3, s->faces[0], 2, s->side_len, depth);
-      copy_side(copy->faces[5], 0, s->faces[3], 3, s->side_len, depth);
-      copy_side(copy->faces[1], 1, s->faces[5], 0, s->side_len, depth);
-    }
-    else{
-      copy_side(copy->faces[0], 2, s->faces[3], 3, s->side_len, depth);
-      copy_side(copy->faces[3], 3, s->faces[5], 0, s->side_len, depth);
-      copy_side(copy->faces[5], 0, s->faces[1], 1, s->side_len, depth);
-      copy_side(copy->faces[1], 1, s->faces[0], 2, s->side_len, depth);
+
+  /* Move all the connected sides, reading each strip from s and writing it
+   * into copy, so s is never written to. Clockwise, each strip takes the
+   * place of the one before it.
+   */
+  const int (*ring)[2] = RING[face];
+  int step = clockwise ? 1 : NUM_SIDES - 1;
+  for(int i = 0; i < NUM_SIDES; i++){
+    int next = (i + step) % NUM_SIDES;
+    move_strip(copy->faces[ring[i][0]], ring[i][1],
+               s->faces[ring[next][0]], ring[next][1], s->side_len, depth);
+  }
+
+  return copy;
+}
+
+void apply_move(state_t *s, move_t m){
+  if(s == NULL || m.face < 0 || m.face >= NUM_FACES
+     || m.depth < 0 || m.depth >= s->side_len){
+    return;
+  }
+
+  int n = s->side_len;
+  int turns = ((m.turns % 4) + 4) % 4;
+  if(turns == 0){
+    return;
+  }
+  own_faces(s, m.face, m.depth);
+
+  if(s->kernel != NULL){
+    s->kernel(s->faces, m.face, m.depth, turns);
+    return;
+  }
+  if(s->packed != NULL){
+    m.turns = turns;
+    packed_move(s, m);
+    return;
+  }
+
+  //Rotate the side itself (don't do this if turning an interior slice)
+  if(m.depth == 0){
+    for(int i = 0; i < turns; i++){
+      rotate_face(s->faces[m.face], n);
     }
-    break;
-  case 3:
-    if(clockwise){
-      copy_side(copy->faces[0], 1, s->faces[4], 3, s->side_len, depth);
-      copy_side(copy->faces[2], 1, s->faces[0], 1, s->side_len, depth);
-      copy_side(copy->faces[5], 1, s->faces[2], 1, s->side_len, depth);
-      copy_side(copy->faces[4], 3, s->faces[5], 1, s->side_len, depth);
+  }
+
+  /* Cycle the strips around the face. A quarter turn is a single cycle of
+   * four strips and a half turn is two swaps. The first strip of each cycle
+   * is saved to temp, since it is overwritten before it is read.
+   */
+  const int (*ring)[2] = RING[m.face];
+  int step = turns == 3 ? NUM_SIDES - 1 : turns;
+  int cycles = turns == 2 ? 2 : 1;
+  color temp[n];
+
+  for(int c = 0; c < cycles; c++){
+    color *first = s->faces[ring[c][0]];
+    for(int j = 0; j < n; j++){
+      temp[j] = first[strip_coord(ring[c][1], m.depth, j, n)];
     }
-    else{
-      copy_side(copy->faces[0], 1, s->faces[2], 1, s->side_len, depth);
-      copy_side(copy->faces[2], 1, s->faces[5], 1, s->side_len, depth);
-      copy_side(copy->faces[5], 1, s->faces[4], 3, s->side_len, depth);
-      copy_side(copy->faces[4], 3, s->faces[0], 1, s->side_len, depth);
+
+    int pos = c;
+    for(int i = 0; i < NUM_SIDES / cycles - 1; i++){
+      int next = (pos + step) % NUM_SIDES;
+      move_strip(s->faces[ring[pos][0]], ring[pos][1],
+                 s->faces[ring[next][0]], ring[next][1], n, m.depth);
+      pos = next;
     }
-    break;
-  case 4:
-    if(clockwise){
-      copy_side(copy->faces[0], 0, s->faces[3], 1, s->side_len, depth);
-      copy_side(copy->faces[3], 1, s->faces[5], 2, s->side_len, depth);
-      copy_side(copy->faces[5], 2, s->faces[1], 3, s->side_len, depth);
-      copy_side(copy->faces[1], 3, s->faces[0], 0, s->side_len, depth);
+
+    color *last = s->faces[ring[pos][0]];
+    for(int j = 0; j < n; j++){
+      last[strip_coord(ring[pos][1], m.depth, j, n)] = temp[j];
     }
-    else{
-      copy_side(copy->faces[0], 0, s->faces[1], 3, s->side_len, depth);
-      copy_side(copy->faces[3], 1, s->faces[0], 0, s->side_len, depth);
-      copy_side(copy->faces[5], 2, s->faces[3], 1, s->side_len, depth);
-      copy_side(copy->faces[1], 3, s->faces[5], 2, s->side_len, depth);
+  }
+}
+
+void state_set_kernel(state_t *s, bool specialized){
+  if(s != NULL && s->packed == NULL){
+    s->kernel = specialized ? kernel_for(s->side_len) : NULL;
+  }
+}
+
+void state_set_packed(state_t *s, bool packed){
+  if(s == NULL || packed == (s->packed != NULL)
+     || (packed && !state_can_pack(s->side_len))){
+    return;
+  }
+
+  int n = s->side_len;
+  int row_words = (n + STICKERS_PER_WORD - 1) / STICKERS_PER_WORD;
+
+  if(packed){
+    s->row_words = row_words;
+    s->packed = Calloc(NUM_FACES, sizeof(uint64_t *));
+    for(int i = 0; i < NUM_FACES; i++){
+      s->packed[i] = new_block((size_t) n * row_words * sizeof(uint64_t));
+      for(int y = 0; y < n; y++){
+        write_row(s, i, y, s->faces[i] + y * n);
+      }
+      release_block(s->faces[i]);
     }
-    break;
-  default:
-    if(clockwise){
-      copy_side(copy->faces[1], 2, s->faces[2], 2, s->side_len, depth);
-      copy_side(copy->faces[2], 2, s->faces[3], 2, s->side_len, depth);
-      copy_side(copy->faces[3], 2, s->faces[4], 2, s->side_len, depth);
-      copy_side(copy->faces[4], 2, s->faces[1], 2, s->side_len, depth);
+    free(s->faces);
+    s->faces = NULL;
+    s->kernel = NULL;
+  }
+  else{
+    s->faces = Calloc(NUM_FACES, sizeof(color *));
+    for(int i = 0; i < NUM_FACES; i++){
+      s->faces[i] = new_block(n * n * sizeof(color));
+      for(int y = 0; y < n; y++){
+        read_row(s, i, y, s->faces[i] + y * n);
+      }
+      release_block(s->packed[i]);
     }
-    else{
-      copy_side(copy->faces[1], 2, s->faces[4], 2, s->side_len, depth);
-      copy_side(copy->faces[2], 2, s->faces[1], 2, s->side_len, depth);
-      copy_side(copy->faces[3], 2, s->faces[2], 2, s->side_len, depth);
-      copy_side(copy->faces[4], 2, s->faces[3], 2, s->side_len, depth);
+    free(s->packed);
+    s->packed = NULL;
+    release_block(s->scratch);
+    s->scratch = NULL;
+    s->kernel = kernel_for(n);
+  }
+}
+
+bool state_can_pack(int side_len){
+  return side_len >= MIN_PACKED_SIZE;
+}
+
+bool state_is_packed(state_t *s){
+  return s != NULL && s->packed != NULL;
+}
+
+size_t state_bytes(state_t *s){
+  if(s == NULL){
+    return 0;
+  }
+  if(s->packed != NULL){
+    return NUM_FACES * (size_t) s->side_len * s->row_words * sizeof(uint64_t);
+  }
+  return NUM_FACES * (size_t) s->side_len * s->side_len * sizeof(color);
+}
+
+bool state_has_kernel(int side_len){
+  return kernel_for(side_len) != NULL;
+}
+
+int state_side_len(state_t *s){
+  return s == NULL ? 0 : s->side_len;
+}
+
+color state_sticker(state_t *s, int index){
+  int face_len = s->side_len * s->side_len;
+  return get_sticker(s, index / face_len, index % face_len);
+}
+
+void state_export(state_t *s, color *stickers){
+  if(s == NULL || stickers == NULL){
+    return;
+  }
+
+  int n = s->side_len;
+  for(int i = 0; i < NUM_FACES; i++){
+    for(int y = 0; y < n; y++){
+      read_row(s, i, y, stickers + (i * n + y) * n);
     }
-    break;
+  }
+}
+
+state_t *state_import(int side_len, const color *stickers){
+  state_t *ret = new_state(side_len);
+  if(stickers == NULL){
+    return ret;
   }
   
-  return copy;
+  int face_len = side_len * side_len;
+  for(int i = 0; i < NUM_FACES; i++){
+    memcpy(ret->faces[i], stickers + i * face_len, face_len);
+  }
+
+  return ret;
 }
 
 bool state_equal(state_t *s1, state_t *s2){
@@ -259,13 +588,30 @@ bool state_equal(state_t *s1, state_t *s2){
     return false;
   }
 
-  int face_length = s1->side_len * s1->side_len;
+  int n = s1->side_len;
+  color row1[n];
+  color row2[n];
 
-  //Now compare every cell of each face
+  //Now compare every row of each face, skipping those the two share
   for(int i = 0; i < NUM_FACES; i++){
-    for(int j = 0; j < face_length; j++){
-      if(s1->faces[i][j] != s2->faces[i][j]){
-	return false;
+    if(face_data(s1, i) == face_data(s2, i)){
+      continue;
+    }
+
+    for(int y = 0; y < n; y++){
+      //Packed rows are zero past the last sticker, so whole words compare
+      if(s1->packed != NULL && s2->packed != NULL){
+        if(memcmp(packed_row(s1, i, y), packed_row(s2, i, y),
+                  s1->row_words * sizeof(uint64_t)) != 0){
+          return false;
+        }
+        continue;
+      }
+
+      read_row(s1, i, y, row1);
+      read_row(s2, i, y, row2);
+      if(memcmp(row1, row2, n) != 0){
+        return false;
       }
     }
   }
@@ -274,7 +620,7 @@ bool state_equal(state_t *s1, state_t *s2){
 }
 
 void print_state(state_t *s){
-  if(s == NULL || s->faces == NULL){
+  if(s == NULL){
     return;
   }
 
@@ -298,7 +644,7 @@ void print_state(state_t *s){
     
     for(int j = 0; j < s->side_len; j++){
       //We need to convert the color to something we can actually represent
-      color c = s->faces[0][get_coord(j, i, s->side_len)];
+      color c = get_sticker(s, 0, get_coord(j, i, s->side_len));
       int actual_color = ctoa(c);
 
       //Then we can add it to the buffer
@@ -335,7 +681,7 @@ void print_state(state_t *s){
       }
 
       int coord = get_coord(j % s->side_len, i, s->side_len);
-      color c = s->faces[1 + j / s->side_len][coord];
+      color c = get_sticker(s, 1 + j / s->side_len, coord);
       int actual_color = ctoa(c);
 
       addch(actual_color);
@@ -362,7 +708,8 @@ void print_state(state_t *s){
     addch(ACS_VLINE);
     
     for(int j = 0; j < s->side_len; j++){
-      color c = s->faces[NUM_FACES - 1][get_coord(j, i, s->side_len)];
+      int coord = get_coord(j, i, s->side_len);
+      color c = get_sticker(s, NUM_FACES - 1, coord);
       int actual_color = ctoa(c);
 
       addch(actual_color);
@@ -381,10 +728,96 @@ void print_state(state_t *s){
   addch(ACS_LRCORNER);
 }
 
+void write_state(FILE *f, state_t *s){
+  if(f == NULL || s == NULL){
+    return;
+  }
+
+  const char *letters = COLOR_LETTERS;
+  int face_len = s->side_len * s->side_len;
+  for(int i = 0; i < NUM_FACES; i++){
+    for(int j = 0; j < face_len; j++){
+      int c = get_sticker(s, i, j);
+      fputc(c >= 0 && c < NUM_FACES ? letters[c] : '?', f);
+    }
+    fputc('\n', f);
+  }
+}
+
+int color_from_letter(char letter){
+  const char *letters = COLOR_LETTERS;
+  for(int i = 0; i < NUM_FACES; i++){
+    if(toupper(letter) == letters[i]){
+      return i;
+    }
+  }
+
+  return -1;
+}
+
 /********************
  * HELPER FUNCTIONS *
  ********************/
 
+void *new_block(size_t bytes){
+  block_t *b = Calloc(1, sizeof(block_t) + bytes);
+  b->refs = 1;
+  return b->data;
+}
+
+void *share_block(void *data){
+  block_t *b = (block_t *) ((char *) data - offsetof(block_t, data));
+  __atomic_add_fetch(&b->refs, 1, __ATOMIC_RELAXED);
+  return data;
+}
+
+void release_block(void *data){
+  if(data == NULL){
+    return;
+  }
+
+  block_t *b = (block_t *) ((char *) data - offsetof(block_t, data));
+  if(__atomic_sub_fetch(&b->refs, 1, __ATOMIC_ACQ_REL) == 0){
+    free(b);
+  }
+}
+
+void *own_block(void *data, size_t bytes){
+  //Only a state using data can share it, so a count of one stays that way
+  block_t *b = (block_t *) ((char *) data - offsetof(block_t, data));
+  if(__atomic_load_n(&b->refs, __ATOMIC_ACQUIRE) == 1){
+    return data;
+  }
+
+  void *ret = new_block(bytes);
+  memcpy(ret, data, bytes);
+  release_block(data);
+  return ret;
+}
+
+static inline void *face_data(state_t *s, int face){
+  return s->packed != NULL ? (void *) s->packed[face] : (void *) s->faces[face];
+}
+
+void own_faces(state_t *s, int face, int depth){
+  int n = s->side_len;
+  for(int i = -1; i < NUM_SIDES; i++){
+    //The turning face itself only changes when it is the slice being turned
+    if(i < 0 && depth != 0){
+      continue;
+    }
+
+    int f = i < 0 ? face : RING[face][i][0];
+    if(s->packed != NULL){
+      s->packed[f] = own_block(s->packed[f],
+                               (size_t) n * s->row_words * sizeof(uint64_t));
+    }
+    else{
+      s->faces[f] = own_block(s->faces[f], n * n * sizeof(color));
+    }
+  }
+}
+
 void rotate_face(color *face, int side_len){
   if(face == NULL){
     return;
@@ -418,40 +851,369 @@ void rotate_face(color *face, int side_len){
   }
 }
 
-void copy_side(color *dest,
-               int dest_side,
-               color *source,
-               int source_side,
-               int side_len,
-	       int depth){
-  //Rotate both these sides to the top for easy copying
-  if(dest_side != 0){
-    for(int i = 0; i + dest_side < 4; i++){
-      rotate_face(dest, side_len);
+int strip_coord(int side, int depth, int j, int side_len){
+  //Each strip runs clockwise around its own face
+  switch(side){
+  case 0:
+    return get_coord(j, depth, side_len);
+  case 1:
+    return get_coord(side_len - 1 - depth, j, side_len);
+  case 2:
+    return get_coord(side_len - 1 - j, side_len - 1 - depth, side_len);
+  default:
+    return get_coord(depth, side_len - 1 - j, side_len);
+  }
+}
+
+void move_strip(color *dest,
+                int dest_side,
+                color *source,
+                int source_side,
+                int side_len,
+                int depth){
+  for(int j = 0; j < side_len; j++){
+    dest[strip_coord(dest_side, depth, j, side_len)]
+      = source[strip_coord(source_side, depth, j, side_len)];
+  }
+}
+
+static inline void strip_layout(int side,
+                                int depth,
+                                int side_len,
+                                int *start,
+                                int *stride){
+  //The same strips as strip_coord, written as a start and a step
+  int last = side_len - 1;
+  switch(side){
+  case 0:
+    *start = depth * side_len;
+    *stride = 1;
+    break;
+  case 1:
+    *start = last - depth;
+    *stride = side_len;
+    break;
+  case 2:
+    *start = (last - depth) * side_len + last;
+    *stride = -1;
+    break;
+  default:
+    *start = last * side_len + depth;
+    *stride = -side_len;
+    break;
+  }
+}
+
+static inline void turn_kernel(color **faces,
+                               int side_len,
+                               int face,
+                               int depth,
+                               int turns){
+  int n = side_len;
+
+  //Rotate the face itself, reading from a copy since every sticker moves
+  if(depth == 0){
+    color *f = faces[face];
+    color old[n * n];
+    memcpy(old, f, n * n);
+
+    if(turns == 1){
+      for(int y = 0; y < n; y++){
+        for(int x = 0; x < n; x++){
+          f[y * n + x] = old[(n - 1 - x) * n + y];
+        }
+      }
+    }
+    else if(turns == 2){
+      for(int i = 0; i < n * n; i++){
+        f[i] = old[n * n - 1 - i];
+      }
+    }
+    else{
+      for(int y = 0; y < n; y++){
+        for(int x = 0; x < n; x++){
+          f[y * n + x] = old[x * n + (n - 1 - y)];
+        }
+      }
+    }
+  }
+
+  /* Each strip around the face takes the stickers of the strip turns places
+   * after it in RING. The four strips are on different faces, so a whole
+   * column of them can be read before any is written.
+   */
+  color *strips[NUM_SIDES];
+  int strides[NUM_SIDES];
+  int starts[NUM_SIDES];
+
+  //Written out one by one, so each strip's side is a constant
+  strip_layout(RING[face][0][1], depth, n, &starts[0], &strides[0]);
+  strip_layout(RING[face][1][1], depth, n, &starts[1], &strides[1]);
+  strip_layout(RING[face][2][1], depth, n, &starts[2], &strides[2]);
+  strip_layout(RING[face][3][1], depth, n, &starts[3], &strides[3]);
+  for(int i = 0; i < NUM_SIDES; i++){
+    strips[i] = faces[RING[face][i][0]] + starts[i];
+  }
+
+  for(int j = 0; j < n; j++){
+    color old[NUM_SIDES];
+    for(int i = 0; i < NUM_SIDES; i++){
+      old[i] = strips[i][j * strides[i]];
+    }
+    for(int i = 0; i < NUM_SIDES; i++){
+      strips[i][j * strides[i]] = old[(i + turns) % NUM_SIDES];
+    }
+  }
+}
+
+/* One kernel per size, each just turn_kernel with the size filled in, and
+ * with the face filled in too on each branch of the switch.
+ */
+#define DEFINE_KERNEL(N)                                                \
+  static void turn_kernel_##N(color **faces, int face, int depth, int turns){ \
+    switch(face){                                                       \
+    case 0:                                                             \
+      turn_kernel(faces, N, 0, depth, turns);                           \
+      break;                                                            \
+    case 1:                                                             \
+      turn_kernel(faces, N, 1, depth, turns);                           \
+      break;                                                            \
+    case 2:                                                             \
+      turn_kernel(faces, N, 2, depth, turns);                           \
+      break;                                                            \
+    case 3:                                                             \
+      turn_kernel(faces, N, 3, depth, turns);                           \
+      break;                                                            \
+    case 4:                                                             \
+      turn_kernel(faces, N, 4, depth, turns);                           \
+      break;                                                            \
+    default:                                                            \
+      turn_kernel(faces, N, 5, depth, turns);                           \
+      break;                                                            \
+    }                                                                   \
+  }
+
+DEFINE_KERNEL(2)
+DEFINE_KERNEL(3)
+DEFINE_KERNEL(4)
+DEFINE_KERNEL(5)
+DEFINE_KERNEL(6)
+DEFINE_KERNEL(7)
+
+move_kernel_t kernel_for(int side_len){
+  static const move_kernel_t kernels[MAX_KERNEL_SIZE + 1] = {
+    NULL, NULL,
+    turn_kernel_2, turn_kernel_3, turn_kernel_4,
+    turn_kernel_5, turn_kernel_6, turn_kernel_7
+  };
+
+  if(side_len < MIN_KERNEL_SIZE || side_len > MAX_KERNEL_SIZE){
+    return NULL;
+  }
+  return kernels[side_len];
+}
+
+static inline uint64_t *packed_row(state_t *s, int face, int y){
+  return s->packed[face] + (size_t) y * s->row_words;
+}
+
+static inline color get_sticker(state_t *s, int face, int index){
+  if(s->packed == NULL){
+    return s->faces[face][index];
+  }
+
+  return packed_at(packed_row(s, face, index / s->side_len),
+                   index % s->side_len);
+}
+
+static inline color packed_at(const uint64_t *row, int x){
+  uint64_t word = row[x / STICKERS_PER_WORD];
+  return (word >> (x % STICKERS_PER_WORD * STICKER_BITS)) & STICKER_MASK;
+}
+
+void read_row(state_t *s, int face, int y, color *out){
+  int n = s->side_len;
+  if(s->packed == NULL){
+    memcpy(out, s->faces[face] + y * n, n);
+    return;
+  }
+
+  uint64_t *words = packed_row(s, face, y);
+  int x = 0;
+  for(int w = 0; w < s->row_words; w++){
+    uint64_t word = words[w];
+    int end = MIN(n, x + STICKERS_PER_WORD);
+    for(; x < end; x++){
+      out[x] = word & STICKER_MASK;
+      word >>= STICKER_BITS;
+    }
+  }
+}
+
+void write_row(state_t *s, int face, int y, const color *in){
+  int n = s->side_len;
+  if(s->packed == NULL){
+    memcpy(s->faces[face] + y * n, in, n);
+    return;
+  }
+
+  uint64_t *words = packed_row(s, face, y);
+  int x = 0;
+  for(int w = 0; w < s->row_words; w++){
+    uint64_t word = 0;
+    int end = MIN(n, x + STICKERS_PER_WORD);
+    for(int shift = 0; x < end; x++, shift += STICKER_BITS){
+      word |= (uint64_t) in[x] << shift;
     }
+    words[w] = word;
   }
-  if(source_side != 0){
-    for(int i = 0; i + source_side < 4; i++){
-      rotate_face(source, side_len);
+}
+
+void read_strip(state_t *s, int face, int side, int depth, color *buf){
+  int n = s->side_len;
+  if(side == 0){
+    read_row(s, face, depth, buf);
+  }
+  else if(side == 2){
+    //The bottom strip runs right to left
+    color row[n];
+    read_row(s, face, n - 1 - depth, row);
+    for(int j = 0; j < n; j++){
+      buf[j] = row[n - 1 - j];
     }
   }
+  else{
+    //Side 1 runs down the column n - 1 - depth and side 3 up column depth
+    int x = side == 1 ? n - 1 - depth : depth;
+    int y = side == 1 ? 0 : n - 1;
+    int step = side == 1 ? 1 : -1;
+    if(s->packed == NULL){
+      color *f = s->faces[face] + y * n + x;
+      for(int j = 0; j < n; j++){
+        buf[j] = f[j * step * n];
+      }
+      return;
+    }
 
-  //Make the copy
-  memcpy(dest + (depth * side_len), source + (depth * side_len), side_len);
+    uint64_t *word = packed_row(s, face, y) + x / STICKERS_PER_WORD;
+    int shift = x % STICKERS_PER_WORD * STICKER_BITS;
+    ptrdiff_t stride = step * s->row_words;
+    for(int j = 0; j < n; j++){
+      buf[j] = (word[j * stride] >> shift) & STICKER_MASK;
+    }
+  }
+}
 
-  //Rotate them back
-  if(dest_side != 0){
-    for(int i = 0; i < dest_side; i++){
-      rotate_face(dest, side_len);
+void write_strip(state_t *s, int face, int side, int depth, const color *buf){
+  int n = s->side_len;
+  if(side == 0){
+    write_row(s, face, depth, buf);
+  }
+  else if(side == 2){
+    color row[n];
+    for(int j = 0; j < n; j++){
+      row[j] = buf[n - 1 - j];
     }
+    write_row(s, face, n - 1 - depth, row);
   }
-  if(source_side != 0){
-    for(int i = 0; i < source_side; i++){
-      rotate_face(source, side_len);
+  else{
+    int x = side == 1 ? n - 1 - depth : depth;
+    int y = side == 1 ? 0 : n - 1;
+    int step = side == 1 ? 1 : -1;
+    if(s->packed == NULL){
+      color *f = s->faces[face] + y * n + x;
+      for(int j = 0; j < n; j++){
+        f[j * step * n] = buf[j];
+      }
+      return;
+    }
+
+    uint64_t *word = packed_row(s, face, y) + x / STICKERS_PER_WORD;
+    int shift = x % STICKERS_PER_WORD * STICKER_BITS;
+    uint64_t mask = ~((uint64_t) STICKER_MASK << shift);
+    ptrdiff_t stride = step * s->row_words;
+    for(int j = 0; j < n; j++){
+      uint64_t *w = word + j * stride;
+      *w = (*w & mask) | ((uint64_t) buf[j] << shift);
     }
   }
 }
 
+void packed_move(state_t *s, move_t m){
+  int n = s->side_len;
+
+  /* Rotate the face itself into the scratch face, the same way turn_kernel
+   * does, and swap the two. The face was made this state's own before the
+   * move, so the old one is free to be the next scratch face.
+   */
+  if(m.depth == 0){
+    int w = s->row_words;
+    if(s->scratch == NULL){
+      s->scratch = new_block((size_t) n * w * sizeof(uint64_t));
+    }
+    uint64_t *old = s->packed[m.face];
+    uint64_t *rotated = s->scratch;
+
+    for(int y = 0; y < n; y++){
+      uint64_t *out = rotated + (size_t) y * w;
+      memset(out, 0, w * sizeof(uint64_t));
+      int word = 0;
+      int shift = 0;
+      for(int x = 0; x < n; x++){
+        color c;
+        if(m.turns == 1){
+          c = packed_at(old + (size_t) (n - 1 - x) * w, y);
+        }
+        else if(m.turns == 2){
+          c = packed_at(old + (size_t) (n - 1 - y) * w, n - 1 - x);
+        }
+        else{
+          c = packed_at(old + (size_t) x * w, n - 1 - y);
+        }
+
+        out[word] |= (uint64_t) c << shift;
+        shift += STICKER_BITS;
+        if(shift == STICKERS_PER_WORD * STICKER_BITS){
+          shift = 0;
+          word++;
+        }
+      }
+    }
+
+    s->packed[m.face] = rotated;
+    s->scratch = old;
+  }
+
+  //Cycle the strips around the face the same way apply_move does
+  const int (*ring)[2] = RING[m.face];
+  int step = m.turns == 3 ? NUM_SIDES - 1 : m.turns;
+  int cycles = m.turns == 2 ? 2 : 1;
+  color temp[n];
+  color buf[n];
+
+  for(int c = 0; c < cycles; c++){
+    read_strip(s, ring[c][0], ring[c][1], m.depth, temp);
+
+    int pos = c;
+    for(int i = 0; i < NUM_SIDES / cycles - 1; i++){
+      int next = (pos + step) % NUM_SIDES;
+      int side = ring[pos][1];
+      if(side == ring[next][1] && (side == 0 || side == 2)){
+        int y = side == 0 ? m.depth : n - 1 - m.depth;
+        memcpy(packed_row(s, ring[pos][0], y), packed_row(s, ring[next][0], y),
+               s->row_words * sizeof(uint64_t));
+      }
+      else{
+        read_strip(s, ring[next][0], ring[next][1], m.depth, buf);
+        write_strip(s, ring[pos][0], side, m.depth, buf);
+      }
+      pos = next;
+    }
+
+    write_strip(s, ring[pos][0], ring[pos][1], m.depth, temp);
+  }
+}
+
 int ctoa(color c){
   switch(c){
   case 0:
@@ -541,3 +1303,20 @@ bool is_clockwise(char *str){
 
   return str[len - 1] != '\'';
 }
+
+int get_turns(char *str){
+  if(str == NULL){
+    return 1;
+  }
+
+  //Find the face, then look at what comes right after it
+  int i = 0;
+  while(str[i] != '\0' && !isalpha(str[i])){
+    i++;
+  }
+  if(str[i] == '\0'){
+    return 1;
+  }
+
+  return str[i + 1] == '2' ? 2 : 1;
+}
@@ -2,12 +2,27 @@
 #define STATE_H
 
 #include <stdbool.h>
+#include <stdio.h>
 
 /* Colors are the index of the side they started on.
  */
 typedef char color;
 typedef struct state_t state_t;
 
+/* The longest string move_to_string can produce, including the terminator.
+ */
+#define MAX_MOVE_STR_LEN 16
+
+/* A single parsed turn. face is the index of the face being turned, depth is
+ * how many layers in from that face the slice is (0 is the face itself), and
+ * turns is the number of clockwise quarter turns to make, from 1 to 3.
+ */
+typedef struct move_t{
+  int face;
+  int depth;
+  int turns;
+} move_t;
+
 /* Returns a state with every side set to its index.
  */
 state_t *new_state(int side_len);
@@ -16,15 +31,96 @@ state_t *new_state(int side_len);
  */
 void free_state(state_t *s);
 
-/* Returns an exact duplicate of a given state.
+/* Returns an exact duplicate of a given state. The two share their faces
+ * until either one is turned, when the faces that turn changes are copied:
+ * five of the six for a turn of a face, and four for an inner slice. So
+ * taking a copy is cheap, but the first turn of it costs most of a full copy.
  */
 state_t *copy_state(state_t *s);
 
 /* Returns a new state with the given move on the given state rotated either
  * clockwise or counterclockwise. The move and direction is contained in input.
+ * A trailing "2" after the face, as in "U2", makes a half turn instead.
+ * The new state shares every face the move leaves alone with s.
  */
 state_t *make_move(state_t *s, char *input);
 
+/* Parses input the same way make_move does and stores the result in m.
+ * Returns false if input does not name a face or has a negative depth. The
+ * depth is not checked against any cube size.
+ */
+bool parse_move(char *input, move_t *m);
+
+/* Writes the shortest string make_move understands for m into buf, which
+ * must have room for MAX_MOVE_STR_LEN characters.
+ */
+void move_to_string(move_t m, char *buf);
+
+/* Makes the move m on s in place, without copying the state or parsing a
+ * string. This is the kernel to use when applying many moves in a row; it
+ * gives exactly the same result as make_move. Moves that are too deep for s
+ * are ignored.
+ */
+void apply_move(state_t *s, move_t m);
+
+/* Returns the index into a face of the jth sticker of the strip depth layers
+ * in from the given side of that face. Sides are numbered clockwise from the
+ * top, and every strip runs clockwise around its own face.
+ */
+int strip_coord(int side, int depth, int j, int side_len);
+
+/* Sizes 2 to 7 are turned by move kernels made for that size alone, which
+ * new_state picks out. This switches s between its specialized kernel and the
+ * generic code every other size uses, mostly so the two can be compared.
+ * Copies of s, including those make_move returns, keep the same choice.
+ */
+void state_set_kernel(state_t *s, bool specialized);
+
+/* Returns true if the given size has a kernel of its own.
+ */
+bool state_has_kernel(int side_len);
+
+/* Switches s between a byte per sticker and a packed form of three bits per
+ * sticker, which takes around a third of the memory and is meant for large
+ * cubes. Packed states are turned by generic code that copies whole words
+ * where it can, never by a kernel. Every other function works the same on
+ * either form, and copies of s keep the same one. Sizes too small for
+ * state_can_pack stay a byte per sticker.
+ */
+void state_set_packed(state_t *s, bool packed);
+
+/* Returns true if packing a cube of the given size saves memory, which it
+ * only does once a row has more than eight stickers.
+ */
+bool state_can_pack(int side_len);
+
+/* Returns true if s is packed.
+ */
+bool state_is_packed(state_t *s);
+
+/* Returns how many bytes the stickers of s take up.
+ */
+size_t state_bytes(state_t *s);
+
+/* Returns the side length of the given state.
+ */
+int state_side_len(state_t *s);
+
+/* Returns the sticker at the given index, numbered the way state_export lays
+ * them out.
+ */
+color state_sticker(state_t *s, int index);
+
+/* Copies every sticker of s into stickers, which must have room for
+ * 6 * side_len * side_len colors. Faces are stored in order, each one row by
+ * row, the same way they are laid out in print_state.
+ */
+void state_export(state_t *s, color *stickers);
+
+/* Returns a new state with the stickers written out by state_export.
+ */
+state_t *state_import(int side_len, const color *stickers);
+
 /* Returns true if the two given states are the same, including cube 
  * orientation (for example, all sides are solid, but located in a different
  * region of our 2-D mapping returns false when compared with a fresh cube).
@@ -41,4 +137,14 @@ bool state_equal(state_t *s1, state_t *s2);
  */
 void print_state(state_t *s);
 
+/* Writes every face of s to f as one line of color letters, in face order.
+ * Unlike print_state, this does not need ncurses.
+ */
+void write_state(FILE *f, state_t *s);
+
+/* Returns the color written as the given letter by write_state, or -1 if it
+ * is not one of them. Lowercase letters are accepted too.
+ */
+int color_from_letter(char letter);
+
 #endif
@@ -0,0 +1,788 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "helpers.h"
+#include "twophase.h"
+
+#define NUM_FACES 6
+#define NUM_MOVES 18
+#define NUM_PHASE2_MOVES 10
+
+#define NUM_TWISTS 2187     //3^7, the last corner's twist follows
+#define NUM_FLIPS 2048      //2^11, the last edge's flip follows
+#define NUM_SLICES 495      //12 choose 4 places for the middle layer edges
+#define NUM_CPERMS 40320    //8!
+#define NUM_UDEDGES 40320   //8! orders of the U and D layer edges
+#define NUM_SLICEPERMS 24   //4! orders of the middle layer edges
+
+#define MAX_PHASE1_DEPTH 12
+#define MAX_PHASE2_DEPTH 18
+#define MAX_SOLUTION_LEN (MAX_PHASE1_DEPTH + MAX_PHASE2_DEPTH)
+#define UNSEEN 0xFF
+#define TABLE_MAGIC "CSTPTBL1"
+#define TABLE_OFFSET 64
+
+//How many nodes to search between looking at the clock
+#define CLOCK_INTERVAL 4096
+
+/* Moves are numbered face * 3 + turns - 1, so B B2 B' L L2 L' and so on.
+ * These are the ones that keep a cube inside the phase 2 group.
+ */
+static const int PHASE2_MOVES[NUM_PHASE2_MOVES] = {
+  1, 4, 6, 7, 8, 10, 12, 13, 14, 16
+};
+static const int OPPOSITE_FACE[NUM_FACES] = {5, 3, 4, 1, 2, 0};
+
+/* The tables, built once by twophase_init and then only read. Move tables
+ * give the coordinate a move leads to, and pruning tables give how many
+ * moves it takes to solve a pair of coordinates, which never overestimates
+ * how far away the whole cube is.
+ */
+typedef struct tables_t{
+  cubie_t move_cubies[NUM_MOVES];
+  uint16_t twist_move[NUM_TWISTS][NUM_MOVES];
+  uint16_t flip_move[NUM_FLIPS][NUM_MOVES];
+  uint16_t slice_move[NUM_SLICES][NUM_MOVES];
+  uint16_t cperm_move[NUM_CPERMS][NUM_PHASE2_MOVES];
+  uint16_t udedge_move[NUM_UDEDGES][NUM_PHASE2_MOVES];
+  uint16_t sliceperm_move[NUM_SLICEPERMS][NUM_PHASE2_MOVES];
+  unsigned char twist_slice_prune[NUM_TWISTS * NUM_SLICES];
+  unsigned char flip_slice_prune[NUM_FLIPS * NUM_SLICES];
+  unsigned char cperm_slice_prune[NUM_CPERMS * NUM_SLICEPERMS];
+  unsigned char udedge_slice_prune[NUM_UDEDGES * NUM_SLICEPERMS];
+} tables_t;
+
+/* A saved table file starts with this header, padded out to TABLE_OFFSET
+ * bytes, so that a file from a different build is never taken for tables.
+ */
+typedef struct table_header_t{
+  char magic[8];
+  uint64_t size;
+} table_header_t;
+
+/* The tables in use, either built in memory or mapped from a file. Set once
+ * and never changed after, under tables_lock.
+ */
+static tables_t *tables;
+static pthread_mutex_t tables_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+/* Everything one search needs, so that searches can run side by side.
+ */
+typedef struct search_t{
+  cubie_t start;
+  solve_options_t opts;
+  double deadline;
+  long nodes;
+  bool done;
+  bool cancelled;
+  bool short_enough;    //Stop once the phase 1 depth being searched is done
+
+  int moves[MAX_SOLUTION_LEN];
+  int phase1_len;
+
+  int best[MAX_SOLUTION_LEN];
+  int best_len;
+} search_t;
+
+/******************************
+ * HELPER FUNCTION PROTOTYPES *
+ ******************************/
+
+/* Builds every table. Only called through pthread_once.
+ */
+void build_tables();
+
+/* Coordinates of a cube, and ways to build a cube with a given coordinate.
+ * The setters only fill in the pieces their coordinate describes.
+ */
+int get_twist(const cubie_t *c);
+void set_twist(cubie_t *c, int twist);
+int get_flip(const cubie_t *c);
+void set_flip(cubie_t *c, int flip);
+int get_slice(const cubie_t *c);
+void set_slice(cubie_t *c, int slice);
+int get_cperm(const cubie_t *c);
+void set_cperm(cubie_t *c, int cperm);
+int get_udedge(const cubie_t *c);
+void set_udedge(cubie_t *c, int udedge);
+int get_sliceperm(const cubie_t *c);
+void set_sliceperm(cubie_t *c, int sliceperm);
+
+/* Returns the position of perm among all orderings of 0 to len - 1, and
+ * fills perm with the ordering at a position.
+ */
+int rank_perm(const int *perm, int len);
+void unrank_perm(int rank, int *perm, int len);
+
+/* Returns n choose k.
+ */
+int choose(int n, int k);
+
+/* Fills a pruning table over pairs of coordinates by a breadth first search
+ * out from the solved pair. The move tables are indexed by the position of
+ * each move in the list given.
+ */
+void build_pruning(unsigned char *table,
+                   int size_a,
+                   const uint16_t *move_a,
+                   int size_b,
+                   const uint16_t *move_b,
+                   int num_moves);
+
+/* Returns false if move should not follow prev, because it turns the same
+ * face or because the two commute and this is the order we skip. prev is -1
+ * for the first move.
+ */
+bool move_allowed(int prev, int move);
+
+/* Returns true if the search has run out of time or been cancelled,
+ * checking only every so often.
+ */
+bool out_of_time(search_t *s);
+
+/* Searches for every phase 1 solution exactly togo moves longer than the
+ * depth moves already in s->moves, handing each one to phase 2.
+ */
+void phase1(search_t *s, int twist, int flip, int slice, int depth, int togo);
+
+/* Tries to finish a phase 1 solution of s->phase1_len moves with a phase 2
+ * one short enough to beat the best solution so far.
+ */
+void start_phase2(search_t *s);
+
+/* Searches for a phase 2 solution exactly togo moves longer than the depth
+ * moves already in s->moves. Returns true if one was found. The first move
+ * may turn the same face as the last move of phase 1, or the opposite face,
+ * which commutes with it, since save_solution merges them.
+ */
+bool phase2(search_t *s, int cperm, int udedge, int sliceperm, int depth,
+            int togo);
+
+/* Copies the len moves in s->moves into best, simplified so that the moves
+ * on one axis where the two phases meet are merged. Returns the length of
+ * what was saved.
+ */
+int save_solution(const search_t *s, int len, int *best);
+
+/****************************
+ * FUNCTION IMPLEMENTATIONS *
+ ****************************/
+
+void twophase_init(){
+  pthread_once(&tables_once, build_tables);
+}
+
+bool twophase_save_tables(const char *path){
+  twophase_init();
+  FILE *f = fopen(path, "wb");
+  if(f == NULL){
+    fprintf(stderr, "Could not open %s\n", path);
+    return false;
+  }
+
+  unsigned char header[TABLE_OFFSET] = {0};
+  table_header_t h;
+  memcpy(h.magic, TABLE_MAGIC, sizeof(h.magic));
+  h.size = sizeof(tables_t);
+  memcpy(header, &h, sizeof(h));
+
+  bool ok = fwrite(header, TABLE_OFFSET, 1, f) == 1
+    && fwrite(tables, sizeof(tables_t), 1, f) == 1;
+  ok = fclose(f) == 0 && ok;
+  if(!ok){
+    fprintf(stderr, "Could not write %s\n", path);
+  }
+
+  return ok;
+}
+
+bool twophase_load_tables(const char *path){
+  int fd = open(path, O_RDONLY);
+  if(fd < 0){
+    //A missing file is expected the first time, so it is not an error
+    if(errno != ENOENT){
+      fprintf(stderr, "Could not open %s\n", path);
+    }
+    return false;
+  }
+
+  struct stat st;
+  table_header_t h;
+  bool ok = fstat(fd, &st) == 0
+    && st.st_size == TABLE_OFFSET + (off_t) sizeof(tables_t)
+    && read(fd, &h, sizeof(h)) == sizeof(h)
+    && memcmp(h.magic, TABLE_MAGIC, sizeof(h.magic)) == 0
+    && h.size == sizeof(tables_t);
+  if(!ok){
+    fprintf(stderr, "%s does not hold tables from this build\n", path);
+    close(fd);
+    return false;
+  }
+
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(data == MAP_FAILED){
+    fprintf(stderr, "Could not map %s\n", path);
+    return false;
+  }
+
+  pthread_mutex_lock(&tables_lock);
+  bool in_use = tables != NULL;
+  if(!in_use){
+    tables = (tables_t *) ((char *) data + TABLE_OFFSET);
+  }
+  pthread_mutex_unlock(&tables_lock);
+
+  if(in_use){
+    munmap(data, st.st_size);
+    return false;
+  }
+  return true;
+}
+
+bool twophase_lock_tables(){
+  twophase_init();
+
+  //mlock wants whole pages, which mapped tables do not start on
+  long page = sysconf(_SC_PAGESIZE);
+  uintptr_t start = (uintptr_t) tables & ~(uintptr_t) (page - 1);
+  size_t len = (uintptr_t) tables + sizeof(tables_t) - start;
+  if(mlock((void *) start, len) != 0){
+    fprintf(stderr, "Could not lock the tables in memory\n");
+    return false;
+  }
+
+  return true;
+}
+
+solve_options_t default_solve_options(){
+  solve_options_t ret;
+  ret.max_length = DEFAULT_MAX_LENGTH;
+  ret.timeout = DEFAULT_TIMEOUT;
+  ret.cancel = NULL;
+  ret.cancel_arg = NULL;
+
+  return ret;
+}
+
+alg_t *twophase_solve(state_t *s,
+                      const solve_options_t *opts,
+                      solve_stats_t *stats){
+  if(stats != NULL){
+    memset(stats, 0, sizeof(solve_stats_t));
+  }
+  if(s == NULL || state_side_len(s) != 3){
+    return NULL;
+  }
+
+  color stickers[NUM_FACES * 9];
+  cubie_t c;
+  state_export(s, stickers);
+  if(!cubie_from_stickers(stickers, &c)){
+    return NULL;
+  }
+
+  return twophase_solve_cubie(&c, opts, stats);
+}
+
+alg_t *twophase_solve_cubie(const cubie_t *c,
+                            const solve_options_t *opts,
+                            solve_stats_t *stats){
+  twophase_init();
+  double start = get_time();
+
+  search_t *s = Calloc(1, sizeof(search_t));
+  s->start = *c;
+  s->opts = opts != NULL ? *opts : default_solve_options();
+  s->deadline = start + s->opts.timeout;
+  s->best_len = -1;
+
+  int twist = get_twist(c);
+  int flip = get_flip(c);
+  int slice = get_slice(c);
+  int h = MAX(tables->twist_slice_prune[twist * NUM_SLICES + slice],
+              tables->flip_slice_prune[flip * NUM_SLICES + slice]);
+
+  //Longer phase 1 solutions leave room for shorter phase 2 ones
+  for(int depth = h; depth <= MAX_PHASE1_DEPTH && !s->done && !s->short_enough;
+      depth++){
+    if(s->best_len >= 0 && depth >= s->best_len){
+      break;
+    }
+    phase1(s, twist, flip, slice, 0, depth);
+  }
+
+  alg_t *ret = NULL;
+  if(s->best_len >= 0 && !s->cancelled){
+    ret = new_alg(3);
+    for(int i = 0; i < s->best_len; i++){
+      move_t m = {s->best[i] / 3, 0, s->best[i] % 3 + 1};
+      alg_append(ret, m);
+    }
+  }
+
+  if(stats != NULL){
+    stats->valid = true;
+    stats->nodes = s->nodes;
+    stats->seconds = get_time() - start;
+  }
+
+  free(s);
+  return ret;
+}
+
+/********************
+ * HELPER FUNCTIONS *
+ ********************/
+
+void build_tables(){
+  //Nothing to build if they were loaded from a file
+  pthread_mutex_lock(&tables_lock);
+  bool loaded = tables != NULL;
+  pthread_mutex_unlock(&tables_lock);
+  if(loaded){
+    return;
+  }
+
+  //Take each move from the simulator itself, so the two can't disagree
+  tables_t *t = Calloc(1, sizeof(tables_t));
+  color stickers[NUM_FACES * 9];
+  for(int m = 0; m < NUM_MOVES; m++){
+    state_t *s = new_state(3);
+    move_t move = {m / 3, 0, m % 3 + 1};
+    apply_move(s, move);
+    state_export(s, stickers);
+    cubie_from_stickers(stickers, &t->move_cubies[m]);
+    free_state(s);
+  }
+
+  cubie_t a, b;
+  solved_cubie(&a);
+  for(int i = 0; i < NUM_TWISTS; i++){
+    set_twist(&a, i);
+    for(int m = 0; m < NUM_MOVES; m++){
+      cubie_multiply(&a, &t->move_cubies[m], &b);
+      t->twist_move[i][m] = get_twist(&b);
+    }
+  }
+
+  solved_cubie(&a);
+  for(int i = 0; i < NUM_FLIPS; i++){
+    set_flip(&a, i);
+    for(int m = 0; m < NUM_MOVES; m++){
+      cubie_multiply(&a, &t->move_cubies[m], &b);
+      t->flip_move[i][m] = get_flip(&b);
+    }
+  }
+
+  solved_cubie(&a);
+  for(int i = 0; i < NUM_SLICES; i++){
+    set_slice(&a, i);
+    for(int m = 0; m < NUM_MOVES; m++){
+      cubie_multiply(&a, &t->move_cubies[m], &b);
+      t->slice_move[i][m] = get_slice(&b);
+    }
+  }
+
+  //Phase 2 coordinates only make sense for phase 2 moves
+  solved_cubie(&a);
+  for(int i = 0; i < NUM_CPERMS; i++){
+    set_cperm(&a, i);
+    for(int m = 0; m < NUM_PHASE2_MOVES; m++){
+      cubie_multiply(&a, &t->move_cubies[PHASE2_MOVES[m]], &b);
+      t->cperm_move[i][m] = get_cperm(&b);
+    }
+  }
+
+  solved_cubie(&a);
+  for(int i = 0; i < NUM_UDEDGES; i++){
+    set_udedge(&a, i);
+    for(int m = 0; m < NUM_PHASE2_MOVES; m++){
+      cubie_multiply(&a, &t->move_cubies[PHASE2_MOVES[m]], &b);
+      t->udedge_move[i][m] = get_udedge(&b);
+    }
+  }
+
+  solved_cubie(&a);
+  for(int i = 0; i < NUM_SLICEPERMS; i++){
+    set_sliceperm(&a, i);
+    for(int m = 0; m < NUM_PHASE2_MOVES; m++){
+      cubie_multiply(&a, &t->move_cubies[PHASE2_MOVES[m]], &b);
+      t->sliceperm_move[i][m] = get_sliceperm(&b);
+    }
+  }
+
+  build_pruning(t->twist_slice_prune, NUM_TWISTS, t->twist_move[0],
+                NUM_SLICES, t->slice_move[0], NUM_MOVES);
+  build_pruning(t->flip_slice_prune, NUM_FLIPS, t->flip_move[0],
+                NUM_SLICES, t->slice_move[0], NUM_MOVES);
+  build_pruning(t->cperm_slice_prune, NUM_CPERMS, t->cperm_move[0],
+                NUM_SLICEPERMS, t->sliceperm_move[0], NUM_PHASE2_MOVES);
+  build_pruning(t->udedge_slice_prune, NUM_UDEDGES, t->udedge_move[0],
+                NUM_SLICEPERMS, t->sliceperm_move[0], NUM_PHASE2_MOVES);
+
+  //A file may have been loaded while these were being built
+  pthread_mutex_lock(&tables_lock);
+  if(tables == NULL){
+    tables = t;
+    t = NULL;
+  }
+  pthread_mutex_unlock(&tables_lock);
+  free(t);
+}
+
+int get_twist(const cubie_t *c){
+  int ret = 0;
+  for(int i = NUM_CORNERS - 2; i >= 0; i--){
+    ret = ret * 3 + c->co[i];
+  }
+
+  return ret;
+}
+
+void set_twist(cubie_t *c, int twist){
+  int total = 0;
+  for(int i = 0; i < NUM_CORNERS - 1; i++){
+    c->co[i] = twist % 3;
+    total += c->co[i];
+    twist /= 3;
+  }
+  c->co[NUM_CORNERS - 1] = (3 - total % 3) % 3;
+}
+
+int get_flip(const cubie_t *c){
+  int ret = 0;
+  for(int i = NUM_EDGES - 2; i >= 0; i--){
+    ret = ret * 2 + c->eo[i];
+  }
+
+  return ret;
+}
+
+void set_flip(cubie_t *c, int flip){
+  int total = 0;
+  for(int i = 0; i < NUM_EDGES - 1; i++){
+    c->eo[i] = flip % 2;
+    total += c->eo[i];
+    flip /= 2;
+  }
+  c->eo[NUM_EDGES - 1] = total % 2;
+}
+
+int get_slice(const cubie_t *c){
+  /* Counting positions down from the last one, the middle layer edges at
+   * home are at 0 to 3, which ranks as 0 among the sets of four.
+   */
+  int ret = 0;
+  int found = 0;
+  for(int i = NUM_EDGES - 1; i >= 0; i--){
+    if(c->ep[i] >= 8){
+      found++;
+      ret += choose(NUM_EDGES - 1 - i, found);
+    }
+  }
+
+  return ret;
+}
+
+void set_slice(cubie_t *c, int slice){
+  bool in_slice[NUM_EDGES] = {false};
+  for(int k = 4; k >= 1; k--){
+    int q = k - 1;
+    while(choose(q + 1, k) <= slice){
+      q++;
+    }
+    slice -= choose(q, k);
+    in_slice[NUM_EDGES - 1 - q] = true;
+  }
+
+  int next_slice = 8;
+  int next_other = 0;
+  for(int i = 0; i < NUM_EDGES; i++){
+    c->ep[i] = in_slice[i] ? next_slice++ : next_other++;
+  }
+}
+
+int get_cperm(const cubie_t *c){
+  return rank_perm(c->cp, NUM_CORNERS);
+}
+
+void set_cperm(cubie_t *c, int cperm){
+  unrank_perm(cperm, c->cp, NUM_CORNERS);
+}
+
+int get_udedge(const cubie_t *c){
+  return rank_perm(c->ep, 8);
+}
+
+void set_udedge(cubie_t *c, int udedge){
+  unrank_perm(udedge, c->ep, 8);
+}
+
+int get_sliceperm(const cubie_t *c){
+  int perm[4];
+  for(int i = 0; i < 4; i++){
+    perm[i] = c->ep[8 + i] - 8;
+  }
+
+  return rank_perm(perm, 4);
+}
+
+void set_sliceperm(cubie_t *c, int sliceperm){
+  int perm[4];
+  unrank_perm(sliceperm, perm, 4);
+  for(int i = 0; i < 4; i++){
+    c->ep[8 + i] = perm[i] + 8;
+  }
+}
+
+int rank_perm(const int *perm, int len){
+  int ret = 0;
+  for(int i = 0; i < len; i++){
+    int smaller = 0;
+    for(int j = i + 1; j < len; j++){
+      if(perm[j] < perm[i]){
+        smaller++;
+      }
+    }
+    ret = ret * (len - i) + smaller;
+  }
+
+  return ret;
+}
+
+void unrank_perm(int rank, int *perm, int len){
+  //Peel off the digits, last position first
+  int digits[NUM_EDGES];
+  for(int i = len - 1; i >= 0; i--){
+    digits[i] = rank % (len - i);
+    rank /= len - i;
+  }
+
+  bool used[NUM_EDGES] = {false};
+  for(int i = 0; i < len; i++){
+    int skip = digits[i];
+    for(int j = 0; j < len; j++){
+      if(used[j]){
+        continue;
+      }
+      if(skip == 0){
+        perm[i] = j;
+        used[j] = true;
+        break;
+      }
+      skip--;
+    }
+  }
+}
+
+int choose(int n, int k){
+  if(k < 0 || k > n){
+    return 0;
+  }
+
+  int ret = 1;
+  for(int i = 0; i < k; i++){
+    ret = ret * (n - i) / (i + 1);
+  }
+
+  return ret;
+}
+
+void build_pruning(unsigned char *table,
+                   int size_a,
+                   const uint16_t *move_a,
+                   int size_b,
+                   const uint16_t *move_b,
+                   int num_moves){
+  long size = (long) size_a * size_b;
+  memset(table, UNSEEN, size);
+  table[0] = 0;
+
+  long filled = 1;
+  for(int depth = 0; filled < size; depth++){
+    for(long i = 0; i < size; i++){
+      if(table[i] != depth){
+        continue;
+      }
+
+      int a = i / size_b;
+      int b = i % size_b;
+      for(int m = 0; m < num_moves; m++){
+        long next = (long) move_a[a * num_moves + m] * size_b
+          + move_b[b * num_moves + m];
+        if(table[next] == UNSEEN){
+          table[next] = depth + 1;
+          filled++;
+        }
+      }
+    }
+  }
+}
+
+bool move_allowed(int prev, int move){
+  if(prev < 0){
+    return true;
+  }
+
+  int face = move / 3;
+  int prev_face = prev / 3;
+  return face != prev_face
+    && !(OPPOSITE_FACE[face] == prev_face && face < prev_face);
+}
+
+bool out_of_time(search_t *s){
+  s->nodes++;
+  if(s->nodes % CLOCK_INTERVAL != 0){
+    return s->done;
+  }
+
+  if(s->opts.cancel != NULL && s->opts.cancel(s->opts.cancel_arg)){
+    s->cancelled = true;
+    s->done = true;
+  }
+  if(get_time() > s->deadline){
+    s->done = true;
+  }
+
+  return s->done;
+}
+
+void phase1(search_t *s, int twist, int flip, int slice, int depth, int togo){
+  if(togo == 0){
+    /* Ending on a phase 2 move means a shorter phase 1 solution was already
+     * tried, so only take the ones that end on a quarter turn of a side.
+     */
+    if(twist == 0 && flip == 0 && slice == 0){
+      int last = depth > 0 ? s->moves[depth - 1] : -1;
+      if(last < 0 || (last / 3 != 2 && last / 3 != 4 && last % 3 != 1)){
+        s->phase1_len = depth;
+        start_phase2(s);
+      }
+    }
+    return;
+  }
+
+  int prev = depth > 0 ? s->moves[depth - 1] : -1;
+  for(int m = 0; m < NUM_MOVES && !s->done; m++){
+    if(!move_allowed(prev, m)){
+      continue;
+    }
+
+    int t = tables->twist_move[twist][m];
+    int f = tables->flip_move[flip][m];
+    int sl = tables->slice_move[slice][m];
+    int h = MAX(tables->twist_slice_prune[t * NUM_SLICES + sl],
+                tables->flip_slice_prune[f * NUM_SLICES + sl]);
+    if(h >= togo || out_of_time(s)){
+      continue;
+    }
+
+    s->moves[depth] = m;
+    phase1(s, t, f, sl, depth + 1, togo - 1);
+  }
+}
+
+void start_phase2(search_t *s){
+  //Phase 2 coordinates come from the pieces, so replay phase 1 on them
+  cubie_t c = s->start;
+  cubie_t next;
+  for(int i = 0; i < s->phase1_len; i++){
+    cubie_multiply(&c, &tables->move_cubies[s->moves[i]], &next);
+    c = next;
+  }
+
+  int cperm = get_cperm(&c);
+  int udedge = get_udedge(&c);
+  int sliceperm = get_sliceperm(&c);
+  int h = MAX(tables->cperm_slice_prune[cperm * NUM_SLICEPERMS + sliceperm],
+              tables->udedge_slice_prune[udedge * NUM_SLICEPERMS + sliceperm]);
+
+  /* Only solutions shorter than the best so far are worth looking for, but
+   * one as long as it can still be shorter once its two phases are merged.
+   */
+  int limit = MAX_PHASE2_DEPTH;
+  if(s->best_len >= 0){
+    limit = MIN(limit, s->best_len - s->phase1_len);
+  }
+
+  for(int togo = h; togo <= limit && !s->done; togo++){
+    if(phase2(s, cperm, udedge, sliceperm, s->phase1_len, togo)){
+      int best[MAX_SOLUTION_LEN];
+      int len = save_solution(s, s->phase1_len + togo, best);
+      if(s->best_len < 0 || len < s->best_len){
+        s->best_len = len;
+        memcpy(s->best, best, len * sizeof(int));
+        if(s->best_len <= s->opts.max_length){
+          s->short_enough = true;
+        }
+      }
+      break;
+    }
+  }
+}
+
+bool phase2(search_t *s, int cperm, int udedge, int sliceperm, int depth,
+            int togo){
+  if(togo == 0){
+    return cperm == 0 && udedge == 0 && sliceperm == 0;
+  }
+
+  int prev = depth > 0 ? s->moves[depth - 1] : -1;
+  bool first = depth == s->phase1_len && prev >= 0;
+  for(int i = 0; i < NUM_PHASE2_MOVES && !s->done; i++){
+    int m = PHASE2_MOVES[i];
+    bool merges = first
+      && (m / 3 == prev / 3 || OPPOSITE_FACE[m / 3] == prev / 3);
+    if(!move_allowed(prev, m) && !merges){
+      continue;
+    }
+
+    int c = tables->cperm_move[cperm][i];
+    int u = tables->udedge_move[udedge][i];
+    int sp = tables->sliceperm_move[sliceperm][i];
+    int h = MAX(tables->cperm_slice_prune[c * NUM_SLICEPERMS + sp],
+                tables->udedge_slice_prune[u * NUM_SLICEPERMS + sp]);
+    if(h >= togo || out_of_time(s)){
+      continue;
+    }
+
+    s->moves[depth] = m;
+    if(phase2(s, c, u, sp, depth + 1, togo - 1)){
+      return true;
+    }
+  }
+
+  return false;
+}
+
+int save_solution(const search_t *s, int len, int *best){
+  alg_t *a = new_alg(3);
+  for(int i = 0; i < len; i++){
+    move_t m = {s->moves[i] / 3, 0, s->moves[i] % 3 + 1};
+    alg_append(a, m);
+  }
+
+  /* Only the moves where the phases meet can merge, the rest are already as
+   * short as the search allows.
+   */
+  simplify_alg(a);
+  for(int i = 0; i < a->len; i++){
+    best[i] = a->moves[i].face * 3 + a->moves[i].turns - 1;
+  }
+
+  int ret = a->len;
+  free_alg(a);
+  return ret;
+}
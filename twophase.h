@@ -0,0 +1,82 @@
+#ifndef TWOPHASE_H
+#define TWOPHASE_H
+
+#include <stdbool.h>
+#include "alg.h"
+#include "cubie.h"
+#include "state.h"
+
+#define DEFAULT_MAX_LENGTH 22
+#define DEFAULT_TIMEOUT 1.0
+
+/* How hard twophase_solve should try. Once it finds a solution of at most
+ * max_length moves, the search only finishes the phase 1 depth it is on, in
+ * case a shorter solution shares that depth. Otherwise it keeps looking for
+ * shorter ones until timeout seconds have passed and returns the best so far.
+ * If cancel is set, it is called with cancel_arg every so often, and the
+ * search gives up and returns nothing as soon as it returns true.
+ */
+typedef struct solve_options_t{
+  int max_length;
+  double timeout;
+  bool (*cancel)(void *arg);
+  void *cancel_arg;
+} solve_options_t;
+
+/* What a call to twophase_solve did. valid is false if the cube given could
+ * not be solved at all, as opposed to no solution being found in time.
+ */
+typedef struct solve_stats_t{
+  bool valid;
+  long nodes;
+  double seconds;
+} solve_stats_t;
+
+/* Builds the move and pruning tables the solver needs, which takes a moment
+ * and a few megabytes. It is safe to call this any number of times and from
+ * several threads; only the first call does any work. twophase_solve calls
+ * it itself, so this is only needed to pay that cost up front.
+ */
+void twophase_init();
+
+/* Writes the tables to path, building them first if need be, so that later
+ * runs can load them instead of building them again. Returns false if the
+ * file could not be written.
+ */
+bool twophase_save_tables(const char *path);
+
+/* Maps tables written by twophase_save_tables into memory in place of
+ * building them. This only works before the tables are first used. Returns
+ * false, leaving them to be built as usual, if the file is missing, holds
+ * tables from a different build, or the tables are already in use.
+ */
+bool twophase_load_tables(const char *path);
+
+/* Locks the tables into memory, building them first if need be, so they are
+ * never paged out. Returns false if the system would not allow it.
+ */
+bool twophase_lock_tables();
+
+/* Returns the default options.
+ */
+solve_options_t default_solve_options();
+
+/* Solves a 3x3 state in two phases, first bringing it into the group
+ * generated by <U, D, R2, L2, F2, B2> and then solving it within that group,
+ * which finds solutions of around 20 moves in milliseconds, and short ones
+ * for cubes only a few moves from solved. Faces are matched to colors by
+ * their centers. The moves returned are outer face turns, as make_move
+ * understands them. Returns NULL if no solution was found within the
+ * options, or if s is not a solvable 3x3. stats may be NULL.
+ */
+alg_t *twophase_solve(state_t *s,
+                      const solve_options_t *opts,
+                      solve_stats_t *stats);
+
+/* Like twophase_solve, but for a cube already read into its pieces.
+ */
+alg_t *twophase_solve_cubie(const cubie_t *c,
+                            const solve_options_t *opts,
+                            solve_stats_t *stats);
+
+#endif
@@ -0,0 +1,340 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <pthread.h>
+#include "helpers.h"
+#include "perm.h"
+#include "verify.h"
+
+/* What every worker thread shares. Workers take algorithms one at a time, so
+ * a slow one never holds up the others.
+ */
+typedef struct verify_work_t{
+  alg_t **algs;
+  int num_algs;
+  const color *states;
+  int num_states;
+  int num_stickers;
+  goal_t *goal;
+
+  pthread_mutex_t lock;
+  int next_alg;
+
+  //The states each algorithm solved, filled in by whichever worker took it
+  int **solved;
+  int *num_solved;
+} verify_work_t;
+
+/******************************
+ * HELPER FUNCTION PROTOTYPES *
+ ******************************/
+
+/* Fills stickers from a line of color letters for a cube of side_len, either
+ * all of them as one word or each face as a word of its own. Returns false
+ * if the line is anything else, such as a scramble whose moves happen to be
+ * color letters.
+ */
+bool read_sticker_line(const char *line, color *stickers, int side_len);
+
+/* The body of each worker thread.
+ */
+void *verify_worker(void *arg);
+
+/****************************
+ * FUNCTION IMPLEMENTATIONS *
+ ****************************/
+
+alg_t **read_algs(const char *path, int side_len, int *len){
+  FILE *f = fopen(path, "r");
+  if(f == NULL){
+    fprintf(stderr, "Could not open %s\n", path);
+    return NULL;
+  }
+
+  int capacity = 16;
+  alg_t **ret = Calloc(capacity, sizeof(alg_t *));
+  char *line = NULL;
+  size_t cap = 0;
+  *len = 0;
+
+  while(next_content_line(f, &line, &cap) != NULL){
+    alg_t *a = parse_alg(side_len, line);
+    if(a == NULL){
+      fprintf(stderr, "Invalid algorithm in %s: %s\n", path, line);
+      free_algs(ret, *len);
+      ret = NULL;
+      break;
+    }
+
+    if(*len == capacity){
+      alg_t **bigger = Calloc(capacity * 2, sizeof(alg_t *));
+      memcpy(bigger, ret, capacity * sizeof(alg_t *));
+      free(ret);
+      ret = bigger;
+      capacity *= 2;
+    }
+    ret[*len] = a;
+    (*len)++;
+  }
+
+  free(line);
+  fclose(f);
+
+  return ret;
+}
+
+void free_algs(alg_t **algs, int len){
+  if(algs == NULL){
+    return;
+  }
+
+  for(int i = 0; i < len; i++){
+    free_alg(algs[i]);
+  }
+  free(algs);
+}
+
+color *read_states(const char *path, int side_len, int *len){
+  FILE *f = fopen(path, "r");
+  if(f == NULL){
+    fprintf(stderr, "Could not open %s\n", path);
+    return NULL;
+  }
+
+  int num_stickers = 6 * side_len * side_len;
+  int capacity = 16;
+  color *ret = Calloc(capacity * num_stickers, sizeof(color));
+  char *line = NULL;
+  size_t cap = 0;
+  *len = 0;
+
+  while(next_content_line(f, &line, &cap) != NULL){
+    if(*len == capacity){
+      color *bigger = Calloc(capacity * 2 * num_stickers, sizeof(color));
+      memcpy(bigger, ret, capacity * num_stickers);
+      free(ret);
+      ret = bigger;
+      capacity *= 2;
+    }
+    color *stickers = ret + (long) *len * num_stickers;
+    if(!parse_state(line, side_len, stickers)){
+      fprintf(stderr, "Invalid state in %s: %s\n", path, line);
+      free(ret);
+      ret = NULL;
+      break;
+    }
+    (*len)++;
+  }
+
+  free(line);
+  fclose(f);
+
+  return ret;
+}
+
+bool parse_state(const char *line, int side_len, color *stickers){
+  //Anything that isn't a full set of stickers should be a scramble
+  if(read_sticker_line(line, stickers, side_len)){
+    return true;
+  }
+
+  alg_t *a = parse_alg(side_len, line);
+  if(a == NULL){
+    return false;
+  }
+
+  state_t *s = new_state(side_len);
+  for(int i = 0; i < a->len; i++){
+    apply_move(s, a->moves[i]);
+  }
+  state_export(s, stickers);
+  free_state(s);
+  free_alg(a);
+  return true;
+}
+
+verify_results_t *verify_algs(alg_t **algs,
+                              int num_algs,
+                              const color *states,
+                              int num_states,
+                              goal_t *goal,
+                              int threads){
+  verify_results_t *ret = Calloc(1, sizeof(verify_results_t));
+  if(num_algs < 1){
+    return ret;
+  }
+
+  verify_work_t work;
+  work.algs = algs;
+  work.num_algs = num_algs;
+  work.states = states;
+  work.num_states = num_states;
+  work.num_stickers = 6 * algs[0]->side_len * algs[0]->side_len;
+  work.goal = goal;
+  work.next_alg = 0;
+  work.solved = Calloc(num_algs, sizeof(int *));
+  work.num_solved = Calloc(num_algs, sizeof(int));
+  pthread_mutex_init(&work.lock, NULL);
+
+  //There is no point in having more threads than algorithms
+  threads = MAX(1, MIN(threads, num_algs));
+  pthread_t *workers = Calloc(threads, sizeof(pthread_t));
+  double start = get_time();
+
+  for(int i = 0; i < threads; i++){
+    if(pthread_create(&workers[i], NULL, verify_worker, &work) != 0){
+      quit("Error: Could not start a thread!\n");
+    }
+  }
+  for(int i = 0; i < threads; i++){
+    pthread_join(workers[i], NULL);
+  }
+
+  ret->seconds = get_time() - start;
+  ret->threads = threads;
+  ret->pairs = (long) num_algs * num_states;
+
+  //Gather the matches, which come out already in order
+  for(int i = 0; i < num_algs; i++){
+    ret->len += work.num_solved[i];
+  }
+  ret->matches = Calloc(MAX(ret->len, 1), sizeof(match_t));
+  int pos = 0;
+  for(int i = 0; i < num_algs; i++){
+    for(int j = 0; j < work.num_solved[i]; j++){
+      ret->matches[pos].alg = i;
+      ret->matches[pos].state = work.solved[i][j];
+      pos++;
+    }
+    free(work.solved[i]);
+  }
+
+  pthread_mutex_destroy(&work.lock);
+  free(work.solved);
+  free(work.num_solved);
+  free(workers);
+
+  return ret;
+}
+
+void free_verify_results(verify_results_t *r){
+  if(r == NULL){
+    return;
+  }
+
+  free(r->matches);
+  free(r);
+}
+
+/********************
+ * HELPER FUNCTIONS *
+ ********************/
+
+char *next_content_line(FILE *f, char **line, size_t *cap){
+  while(getline(line, cap, f) >= 0){
+    char *comment = strchr(*line, '#');
+    if(comment != NULL){
+      *comment = '\0';
+    }
+
+    //Strip trailing whitespace, including the newline
+    int len = strlen(*line);
+    while(len > 0 && isspace((*line)[len - 1])){
+      len--;
+    }
+    (*line)[len] = '\0';
+
+    for(int i = 0; i < len; i++){
+      if(!isspace((*line)[i])){
+        return *line;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+bool read_sticker_line(const char *line, color *stickers, int side_len){
+  int face_len = side_len * side_len;
+  int num_stickers = 6 * face_len;
+  int count = 0;
+  int words = 0;
+  for(int i = 0; line[i] != '\0'; i++){
+    if(isspace(line[i])){
+      continue;
+    }
+
+    //Every word after the first has to start a new face
+    if(i == 0 || isspace(line[i - 1])){
+      if(count % face_len != 0){
+        return false;
+      }
+      words++;
+    }
+
+    int c = color_from_letter(line[i]);
+    if(c < 0 || count >= num_stickers){
+      return false;
+    }
+    stickers[count] = c;
+    count++;
+  }
+
+  //On a 1x1 a face is one letter, so only the single word is unambiguous
+  return count == num_stickers
+    && (words == 1 || (words == 6 && face_len > 1));
+}
+
+void *verify_worker(void *arg){
+  verify_work_t *work = arg;
+  color *result = Calloc(work->num_stickers, sizeof(color));
+
+  while(true){
+    pthread_mutex_lock(&work->lock);
+    int a = work->next_alg;
+    work->next_alg++;
+    pthread_mutex_unlock(&work->lock);
+
+    if(a >= work->num_algs){
+      break;
+    }
+
+    //Compile once, then run over the whole batch of states
+    perm_t *p = compile_alg(work->algs[a]);
+    int capacity = 0;
+    int *solved = NULL;
+    int num_solved = 0;
+
+    for(int i = 0; i < work->num_states; i++){
+      const color *state = work->states + (long) i * work->num_stickers;
+      apply_perm(p, state, result);
+      if(!goal_matches(work->goal, result)){
+        continue;
+      }
+
+      if(num_solved == capacity){
+        capacity = MAX(16, capacity * 2);
+        int *bigger = Calloc(capacity, sizeof(int));
+        if(solved != NULL){
+          memcpy(bigger, solved, num_solved * sizeof(int));
+          free(solved);
+        }
+        solved = bigger;
+      }
+      solved[num_solved] = i;
+      num_solved++;
+    }
+
+    //Each algorithm has its own slot, so no lock is needed here
+    work->solved[a] = solved;
+    work->num_solved[a] = num_solved;
+    free_perm(p);
+  }
+
+  free(result);
+  return NULL;
+}
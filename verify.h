@@ -0,0 +1,72 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "alg.h"
+#include "goal.h"
+#include "state.h"
+
+/* A pair of an algorithm and a starting state it took to the goal, by their
+ * positions in the lists given to verify_algs.
+ */
+typedef struct match_t{
+  int alg;
+  int state;
+} match_t;
+
+/* Everything verify_algs found, with matches sorted by alg and then state.
+ */
+typedef struct verify_results_t{
+  int len;
+  match_t *matches;
+  long pairs;
+  int threads;
+  double seconds;
+} verify_results_t;
+
+/* Reads a file with one algorithm per line. Blank lines and anything after a
+ * '#' are skipped. Returns NULL if the file could not be read or has an
+ * invalid algorithm, otherwise stores the number of algorithms in *len.
+ */
+alg_t **read_algs(const char *path, int side_len, int *len);
+
+/* Frees a list of algorithms returned by read_algs.
+ */
+void free_algs(alg_t **algs, int len);
+
+/* Reads a file with one state per line, returning their exported stickers one
+ * after another. A line is either every sticker written as a color letter,
+ * the way write_state writes them, as one word or as a word for each face,
+ * or an algorithm to apply to a new cube.
+ * Blank lines and comments are skipped as in read_algs. Returns NULL on an
+ * error, otherwise stores the number of states in *len.
+ */
+color *read_states(const char *path, int side_len, int *len);
+
+/* Fills stickers from one line in the format read_states reads. Returns false
+ * if the line is neither.
+ */
+bool parse_state(const char *line, int side_len, color *stickers);
+
+/* Reads the next line of f with anything on it, removing comments and the
+ * trailing newline. Returns NULL at the end of the file. line and cap are
+ * used the same way getline uses them.
+ */
+char *next_content_line(FILE *f, char **line, size_t *cap);
+
+/* Checks every algorithm against every state, using the given number of
+ * threads, and returns the pairs where doing the algorithm to the state
+ * satisfies goal. Each algorithm is compiled once and then run over all of
+ * the states.
+ */
+verify_results_t *verify_algs(alg_t **algs,
+                              int num_algs,
+                              const color *states,
+                              int num_states,
+                              goal_t *goal,
+                              int threads);
+
+/* Frees the results of verify_algs.
+ */
+void free_verify_results(verify_results_t *r);
+
+#endif